@@ -38,6 +38,9 @@
 /*#define BL_INLINE    inline*/
 /*#define BL_DEBUG     0*/
 /*#define BL_CONST     0*/
+/*#define BL_STATS     0*/
+/*#define BL_LEAN      0*/
+/*#define BL_SAMPLE    0*/
 
 
 /*
@@ -57,6 +60,17 @@ struct blayout {
 	blsize align;
 };
 
+/*
+ * Half the size of `struct blayout` on 64-bit targets, for large tables of
+ * descriptors. Only `blcalc32()` and `blsizeof32()` take it; the fields can
+ * be passed to `blnext()` and `blprev()` as they are.
+ */
+struct blayout32 {
+	uint32_t nmemb;
+	uint32_t size;
+	uint32_t align;
+};
+
 
 /*
  * Boilerplate.
@@ -95,7 +109,9 @@ struct blayout {
 #include <assert.h>  /* assert() */
 #define BL_ASSERT assert
 #endif
-#if defined __cplusplus
+#if defined BL_LEAN && BL_LEAN >= 1
+/* Same run-time checks as `BL_DEBUG == 2`, but no `BL_PRIV_IASSERT()`. */
+#elif defined __cplusplus
 /* Can't do it. */
 #define BL_PRIV_IASSERT(x, _x, msg) BL_ASSERT((_x) && #x msg)
 #elif defined __GNUC__
@@ -132,6 +148,30 @@ struct blayout {
 #error "invalid `BL_DEBUG` value, must be `0`, `1`, `2` or `3`"
 #endif
 
+/*
+ * `BL_PRIV_CHECKS` is the level of the run-time checks that are compiled in,
+ * and `BL_PRIV_ASSERT()` what they're checked with.
+ */
+#if defined BL_SAMPLE && BL_SAMPLE >= 1
+#if defined BL_DEBUG && BL_DEBUG != 0
+#error "`BL_SAMPLE` requires `BL_DEBUG` to be `0`"
+#elif !defined __GNUC__
+#error "`BL_SAMPLE` requires GCC or Clang"
+#endif
+#define BL_PRIV_CHECKS 1
+#define BL_PRIV_ASSERT(x)                                          \
+	((void)(__builtin_expect(bl_priv_sample_left-- <= 1, 0)    \
+	        && bl_priv_sample_reload() && !(x)                 \
+	        && (bl_priv_sample_fail(#x, __FILE__, __LINE__, __func__), 1)))
+#else
+#if defined BL_DEBUG
+#define BL_PRIV_CHECKS BL_DEBUG
+#else
+#define BL_PRIV_CHECKS 0
+#endif
+#define BL_PRIV_ASSERT BL_ASSERT
+#endif
+
 #ifndef BL_ALIGNMENT
 /* C++ */
 #if defined __cplusplus
@@ -223,13 +263,110 @@ struct bl_priv_max_align {
 #define BL_PRIV_INLINE_ALWAYS BL_INLINE
 #endif
 
+#if defined BL_SAMPLE && BL_SAMPLE >= 1
+/*
+ * Sampled checks. Every thread counts assertions down from a random interval
+ * that averages `BL_SAMPLE`; only the one that reaches the end is evaluated,
+ * and the count starts over. A failed check is counted and passed to the
+ * hook, if one is set, instead of aborting.
+ */
+typedef void blsample_hook(const char *expr, const char *file, long line,
+                           const char *func);
+
+/* One of each for the whole program, no matter how many TUs include this. */
+__attribute__((__weak__)) blsample_hook *bl_priv_sample_hook;
+__attribute__((__weak__)) unsigned long long bl_priv_sample_failures;
+
+static __thread unsigned bl_priv_sample_left;
+static __thread unsigned bl_priv_sample_seed;
+
+__attribute__((__noinline__, __cold__, __unused__))
+BL_API int bl_priv_sample_reload(void)
+{
+	register unsigned _x = bl_priv_sample_seed;
+	if (_x == 0)  /* The address differs between threads. */
+		_x = (unsigned)(bluptr)&bl_priv_sample_seed | 1u;
+	/* xorshift32 */
+	_x ^= _x << 13;
+	_x ^= _x >> 17;
+	_x ^= _x << 5;
+	bl_priv_sample_seed = _x;
+	bl_priv_sample_left = 1u + _x % (2u * (unsigned)(BL_SAMPLE) - 1u);
+	return 1;
+}
+
+__attribute__((__noinline__, __cold__, __unused__))
+BL_API void bl_priv_sample_fail(register const char *const _expr,
+                                register const char *const _file,
+                                register const long _line,
+                                register const char *const _func)
+{
+	register blsample_hook *const _hook =
+		__atomic_load_n(&bl_priv_sample_hook, __ATOMIC_ACQUIRE);
+	__atomic_fetch_add(&bl_priv_sample_failures, 1, __ATOMIC_RELAXED);
+	if (_hook != NULL)
+		_hook(_expr, _file, _line, _func);
+}
+
+/* Sets the hook for failed checks (NULL for none); returns the previous one. */
+BL_INLINE
+BL_API blsample_hook *blsample_set_hook(blsample_hook *const _hook)
+{
+	return __atomic_exchange_n(&bl_priv_sample_hook, _hook, __ATOMIC_ACQ_REL);
+}
+
+/* Failed checks so far, over all threads. */
+BL_INLINE
+BL_API unsigned long long blsample_failures(void)
+{
+	return __atomic_load_n(&bl_priv_sample_failures, __ATOMIC_RELAXED);
+}
+#endif
+
 
 /*
  * Functions.
  */
 
-#if defined __GNUC__
-__attribute__((__pure__))  /* <- always use _some_ attributes. */
+/*
+ * One `blcalc()` step: pads `pos` up to `align` and adds `nmemb * size` to
+ * it. Returns the new position, or `0` on wrap-around (`pos` is never `0`).
+ */
+#if defined __GNUC__ && BL_PRIV_CHECKS == 0
+__attribute__((__const__))
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API size_t bl_priv_step(register const size_t _pos,
+                           register const blsize _nmemb,
+                           register const blsize _size,
+                           register const blsize _align)
+{
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_nmemb > 0 && _nmemb <= SIZE_MAX
+	               && "layout `.nmemb` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_size > 0 && _size <= SIZE_MAX
+	               && "layout `.size` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_align > 0 && "layout alignment must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
+	               && "layout alignment must be a power of 2");
+#endif
+	/* TODO: This actually generates a `div` under x64 MSVC... */
+	if (BL_PRIV_UNLIKELY(_nmemb > BL_SIZEMAX / _size))
+		return 0;
+
+	{
+		register size_t _sz = (size_t)_nmemb * (size_t)_size;
+		register const size_t _pad = ~(_pos - 1) & ((size_t)_align - 1);
+		if (BL_PRIV_UNLIKELY(_sz + _pad < _sz))
+			return 0;
+
+		_sz += _pad;
+		return BL_PRIV_UNLIKELY(_pos + _sz < _pos) ? 0 : _pos + _sz;
+	}
+}
+
+#if defined __GNUC__ && BL_PRIV_CHECKS == 0
+__attribute__((__pure__))
 #endif
 BL_PRIV_INLINE_ALWAYS
 BL_API blsize bl_priv_calc(register const blsize _align,
@@ -241,16 +378,16 @@ BL_API blsize bl_priv_calc(register const blsize _align,
 	register const size_t _base = (size_t)_align + (size_t)_offs;
 	register size_t _pos = _base;
 
-#if defined BL_DEBUG && BL_DEBUG >= 1 && !defined BL_PRIV_IASSERT
-	BL_ASSERT(_align > 0 && "`align` must be a power of 2");
-	BL_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
-	          && "`align` must be a power of 2");
-	BL_ASSERT(_offs >= 0 && "`offs` must be non-negative");
-	BL_ASSERT(_n > 0 && _n <= SIZE_MAX && "`n` must be in (0, SIZE_MAX]");
-	BL_ASSERT(_lays != NULL && "`lays` must point to a non-zero-sized array");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+	BL_PRIV_ASSERT(_align > 0 && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
+	               && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(_offs >= 0 && "`offs` must be non-negative");
+	BL_PRIV_ASSERT(_n > 0 && _n <= SIZE_MAX && "`n` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_lays != NULL && "`lays` must point to a non-zero-sized array");
 	/*BL_ASSERT(_prev_size >= 0); */
-	BL_ASSERT(_base >= (size_t)_align
-	          && "detected wrap-around; too large `align` and/or `offs`");
+	BL_PRIV_ASSERT(_base >= (size_t)_align
+	               && "detected wrap-around; too large `align` and/or `offs`");
 #endif
 
 	if (BL_PRIV_UNLIKELY(_pos + (size_t)_prev_size < _pos))
@@ -261,32 +398,53 @@ BL_API blsize bl_priv_calc(register const blsize _align,
 		register blsize _i;
 		for (_i = 0; _i < _n; ++_i) {
 			const struct blayout _l = _lays[_i];
-#if defined BL_DEBUG && BL_DEBUG >= 1
-			BL_ASSERT(_l.nmemb > 0 && _l.nmemb <= SIZE_MAX
-			          && "layout `.nmemb` must be in (0, SIZE_MAX]");
-			BL_ASSERT(_l.size > 0 && _l.size <= SIZE_MAX
-			          && "layout `.size` must be in (0, SIZE_MAX]");
-			BL_ASSERT(_l.align > 0 && "layout alignment must be a power of 2");
-			BL_ASSERT(((size_t)_l.align & ((size_t)_l.align - 1)) == 0
-			          && "layout alignment must be a power of 2");
-#endif
-			/* TODO: This actually generates a `div` under x64 MSVC... */
-			if (BL_PRIV_UNLIKELY(_l.nmemb > BL_SIZEMAX / _l.size))
+			_pos = bl_priv_step(_pos, _l.nmemb, _l.size, _l.align);
+			if (BL_PRIV_UNLIKELY(_pos == 0))
 				return 0;
+		}
+	}
+
+	_pos -= _base;
+	return BL_PRIV_UNLIKELY(_pos > BL_SIZEMAX) ? 0 : (blsize)_pos;
+}
 
-			{
-				register size_t _size = (size_t)_l.nmemb * (size_t)_l.size;
-				register const size_t _pad =
-					~(_pos - 1) & ((size_t)_l.align - 1);
-				if (BL_PRIV_UNLIKELY(_size + _pad < _size))
-					return 0;
+/* Same as `bl_priv_calc()`, for compact descriptors. */
+#if defined __GNUC__ && BL_PRIV_CHECKS == 0
+__attribute__((__pure__))
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API blsize bl_priv_calc32(register const blsize _align,
+                             register const ptrdiff_t _offs,
+                             register const blsize _n,
+                             register const struct blayout32 *const _lays,
+                             register const blsize _prev_size)
+{
+	register const size_t _base = (size_t)_align + (size_t)_offs;
+	register size_t _pos = _base;
 
-				_size += _pad;
-				if (BL_PRIV_UNLIKELY(_pos + _size < _pos))
-					return 0;
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_align > 0 && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
+	               && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(_offs >= 0 && "`offs` must be non-negative");
+	BL_PRIV_ASSERT(_n > 0 && _n <= SIZE_MAX && "`n` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_lays != NULL && "`lays` must point to a non-zero-sized array");
+	BL_PRIV_ASSERT(_base >= (size_t)_align
+	               && "detected wrap-around; too large `align` and/or `offs`");
+#endif
 
-				_pos += _size;
-			}
+	if (BL_PRIV_UNLIKELY(_pos + (size_t)_prev_size < _pos))
+		return 0;
+
+	_pos += (size_t)_prev_size;
+	{
+		register blsize _i;
+		for (_i = 0; _i < _n; ++_i) {
+			const struct blayout32 _l = _lays[_i];
+			_pos = bl_priv_step(_pos, (blsize)_l.nmemb, (blsize)_l.size,
+			                    (blsize)_l.align);
+			if (BL_PRIV_UNLIKELY(_pos == 0))
+				return 0;
 		}
 	}
 
@@ -294,6 +452,270 @@ BL_API blsize bl_priv_calc(register const blsize _align,
 	return BL_PRIV_UNLIKELY(_pos > BL_SIZEMAX) ? 0 : (blsize)_pos;
 }
 
+/*
+ * Unlike `blsizeof()`, can't overflow unless `blsize` is narrower than 64
+ * bits. `blcalc32()` checks for that.
+ */
+#ifdef __GNUC__
+BL_PRIV_ATTR(__nonnull__(1))
+#if BL_PRIV_CHECKS == 0
+__attribute__((__pure__))
+#endif
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API blsize blsizeof32(register const struct blayout32 *const _l)
+{
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_l != NULL && "`l` cannot be NULL");
+#endif
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_l->nmemb > 0 && "layout `.nmemb` must be non-zero");
+	BL_PRIV_ASSERT(_l->size > 0 && "layout `.size` must be non-zero");
+	BL_PRIV_ASSERT(!((blsize)_l->nmemb > BL_SIZEMAX / (blsize)_l->size)
+	               && "object layout is too large");
+	BL_PRIV_ASSERT(_l->align > 0 && (_l->align & (_l->align - 1)) == 0
+	               && "layout alignment must be a power of 2");
+#endif
+	return (blsize)_l->nmemb * (blsize)_l->size;
+}
+
+#define blcalc32(align, offs, n, lays, prev_size) \
+	bl_priv_calc32(align, offs, n, lays, prev_size)
+
+/*
+ * Incremental `blcalc()`, for layouts whose regions are only known one at a
+ * time. Errors are sticky: after one, `blextend()` returns `0` and
+ * `blfinish()` fails.
+ */
+struct blbuild {
+	size_t base;
+	size_t pos;
+	blsize max_align;
+	int err;
+};
+
+#ifdef __GNUC__
+BL_PRIV_ATTR(__nonnull__(1))
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API void blbuild_init(register struct blbuild *const _b,
+                         register const blsize _align,
+                         register const ptrdiff_t _offs)
+{
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_align > 0 && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
+	               && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(_offs >= 0 && "`offs` must be non-negative");
+	BL_PRIV_ASSERT((size_t)_align + (size_t)_offs >= (size_t)_align
+	               && "detected wrap-around; too large `align` and/or `offs`");
+#endif
+	_b->base = (size_t)_align + (size_t)_offs;
+	_b->pos = _b->base;
+	_b->max_align = 1;
+	_b->err = 0;
+}
+
+/*
+ * Appends a region and returns its offset from `block + offs`, like the one
+ * `blnext()` would give it in a block aligned to `align`. Exact as long as
+ * the region is no more strictly aligned than `align`.
+ */
+#ifdef __GNUC__
+BL_PRIV_ATTR(__nonnull__(1))
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API blsize blextend(register struct blbuild *const _b,
+                       register const blsize _nmemb,
+                       register const blsize _size,
+                       register const blsize _align)
+{
+	register const size_t _pos = bl_priv_step(_b->pos, _nmemb, _size,
+	                                          _align);
+	if (BL_PRIV_UNLIKELY(_pos == 0 || _b->err)) {
+		_b->err = 1;
+		return 0;
+	}
+
+	_b->pos = _pos;
+	if (_align > _b->max_align)
+		_b->max_align = _align;
+	/* `bl_priv_step()` made sure this doesn't overflow. */
+	return (blsize)(_pos - (size_t)_nmemb * (size_t)_size - _b->base);
+}
+
+/*
+ * Pads the size so far to a multiple of the largest alignment so far, so that
+ * an array of such blocks keeps every region aligned.
+ */
+#ifdef __GNUC__
+BL_PRIV_ATTR(__nonnull__(1))
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API void blpad_to_align(register struct blbuild *const _b)
+{
+	register const size_t _mask = (size_t)_b->max_align - 1;
+	register const size_t _size = _b->pos - _b->base;
+	register const size_t _pad = ~(_size - 1) & _mask;
+	if (BL_PRIV_UNLIKELY(_b->pos + _pad < _b->pos))
+		_b->err = 1;
+	else
+		_b->pos += _pad;
+}
+
+/*
+ * Returns the total size, as `blcalc()` would, or `0` on error. Stores the
+ * largest alignment among the regions into `*max_align`, unless it's NULL.
+ */
+#ifdef __GNUC__
+BL_PRIV_ATTR(__nonnull__(1))  /* Not pure: writes `*max_align`. */
+#endif
+BL_PRIV_INLINE_ALWAYS
+BL_API blsize blfinish(register const struct blbuild *const _b,
+                       register blsize *const _max_align)
+{
+	register const size_t _size = _b->pos - _b->base;
+	if (_max_align != NULL)
+		*_max_align = _b->max_align;
+	return BL_PRIV_UNLIKELY(_b->err || _size > BL_SIZEMAX) ? 0
+	                                                       : (blsize)_size;
+}
+
+#if defined BL_STATS && BL_STATS >= 1
+/*
+ * Per-call-site `blcalc()` statistics. Every call site owns a `static struct
+ * blstats`, which registers itself in a process-wide list on its first call.
+ * Counters are updated with relaxed atomics.
+ */
+#if !defined __GNUC__
+#error "`BL_STATS` requires GCC or Clang"
+#endif
+
+#include <stdio.h>  /* FILE, fprintf() */
+
+struct blstats {
+	const char *file;
+	const char *func;
+	long line;
+	unsigned long long calls;
+	unsigned long long bytes;     /* Sum of results, net of `prev_size`. */
+	unsigned long long padding;   /* Part of `bytes` lost to alignment. */
+	unsigned long long failures;  /* Calls which returned `0`. */
+	struct blstats *next;
+	int registered;
+};
+
+/* One list for the whole program, no matter how many TUs include this. */
+__attribute__((__weak__)) struct blstats *bl_priv_stats_head;
+
+#define BL_PRIV_RELAXED(p, v) __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+
+__attribute__((__noinline__, __unused__))
+BL_API void bl_priv_stats_register(register struct blstats *const _s,
+                                   register const char *const _func)
+{
+	if (__atomic_exchange_n(&_s->registered, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	_s->func = _func;
+	_s->next = __atomic_load_n(&bl_priv_stats_head, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&bl_priv_stats_head, &_s->next, _s,
+	                                    1, __ATOMIC_RELEASE,
+	                                    __ATOMIC_RELAXED))
+		;
+}
+
+BL_PRIV_INLINE_ALWAYS
+BL_API blsize bl_priv_calc_stats(register struct blstats *const _s,
+                                 register const char *const _func,
+                                 register const blsize _align,
+                                 register const ptrdiff_t _offs,
+                                 register const blsize _n,
+                                 register const struct blayout *const _lays,
+                                 register const blsize _prev_size)
+{
+	register const blsize _r =
+		bl_priv_calc(_align, _offs, _n, _lays, _prev_size);
+	if (BL_PRIV_UNLIKELY(!__atomic_load_n(&_s->registered, __ATOMIC_RELAXED)))
+		bl_priv_stats_register(_s, _func);
+
+	BL_PRIV_RELAXED(&_s->calls, 1);
+	if (BL_PRIV_UNLIKELY(_r == 0)) {
+		BL_PRIV_RELAXED(&_s->failures, 1);
+	} else {
+		/* No need to check for overflow; `bl_priv_calc()` already did. */
+		register size_t _payload = 0;
+		register blsize _i;
+		for (_i = 0; _i < _n; ++_i)
+			_payload += (size_t)_lays[_i].nmemb * (size_t)_lays[_i].size;
+		BL_PRIV_RELAXED(&_s->bytes, (size_t)_r - (size_t)_prev_size);
+		BL_PRIV_RELAXED(&_s->padding,
+		                (size_t)_r - (size_t)_prev_size - _payload);
+	}
+	return _r;
+}
+
+#define BL_PRIV_CALC(align, offs, n, lays, prev_size)                       \
+    (__extension__ ({                                                       \
+        static struct blstats _bl_priv_site =                               \
+            {__FILE__, 0, __LINE__, 0, 0, 0, 0, 0, 0};                      \
+        bl_priv_calc_stats(&_bl_priv_site, __func__,                        \
+                           align, offs, n, lays, prev_size);                \
+    }))
+
+/* Calls `fn` for every call site that has been reached so far. */
+BL_INLINE
+BL_API void blstats_foreach(void (*const _fn)(void *, const struct blstats *),
+                            void *const _ctx)
+{
+	register const struct blstats *_s =
+		__atomic_load_n(&bl_priv_stats_head, __ATOMIC_ACQUIRE);
+	for (; _s != NULL; _s = _s->next)
+		_fn(_ctx, _s);
+}
+
+/* Zeroes the counters of every call site. Sites stay registered. */
+BL_INLINE
+BL_API void blstats_reset(void)
+{
+	register struct blstats *_s =
+		__atomic_load_n(&bl_priv_stats_head, __ATOMIC_ACQUIRE);
+	for (; _s != NULL; _s = _s->next) {
+		__atomic_store_n(&_s->calls, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&_s->bytes, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&_s->padding, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&_s->failures, 0, __ATOMIC_RELAXED);
+	}
+}
+
+BL_INLINE
+BL_API void bl_priv_stats_print(void *const _f,
+                                register const struct blstats *const _s)
+{
+	register const unsigned long long _bytes =
+		__atomic_load_n(&_s->bytes, __ATOMIC_RELAXED);
+	register const unsigned long long _padding =
+		__atomic_load_n(&_s->padding, __ATOMIC_RELAXED);
+	fprintf((FILE *)_f, "%s:%ld (%s): calls=%llu bytes=%llu padding=%llu "
+	        "(%.1f%%) failures=%llu\n", _s->file, _s->line, _s->func,
+	        __atomic_load_n(&_s->calls, __ATOMIC_RELAXED), _bytes, _padding,
+	        _bytes == 0 ? 0.0 : 100.0 * (double)_padding / (double)_bytes,
+	        __atomic_load_n(&_s->failures, __ATOMIC_RELAXED));
+}
+
+/* Prints one line per call site to `f`. */
+BL_INLINE
+BL_API void blstats_dump(FILE *const _f)
+{
+	blstats_foreach(bl_priv_stats_print, _f);
+}
+
+#undef BL_PRIV_RELAXED
+#else
+#define BL_PRIV_CALC(align, offs, n, lays, prev_size) \
+	bl_priv_calc(align, offs, n, lays, prev_size)
+#endif
+
 #undef BL_PRIV_UNLIKELY
 
 #ifdef __GNUC__
@@ -305,15 +727,15 @@ BL_API void *bl_priv_next(register void *_ptr,
                           register const blsize _curr_size,
                           register const blsize _next_align)
 {
-#if defined BL_DEBUG && !defined BL_PRIV_IASSERT
-#if BL_DEBUG >= 2
-	BL_ASSERT(_ptr != NULL && "`ptr` cannot be NULL");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_ptr != NULL && "`ptr` cannot be NULL");
 #endif
-#if BL_DEBUG >= 1
+#if BL_PRIV_CHECKS >= 1
 	/*BL_ASSERT(_curr_size >= 0);*/
-	BL_ASSERT(_next_align > 0 && "`next_align` must be a power of 2");
-	BL_ASSERT(((size_t)_next_align & ((size_t)_next_align - 1)) == 0
-	          && "`next_align` must be a power of 2");
+	BL_PRIV_ASSERT(_next_align > 0 && "`next_align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_next_align & ((size_t)_next_align - 1)) == 0
+	               && "`next_align` must be a power of 2");
 #endif
 #endif
 	_ptr = (char *)_ptr + _curr_size;
@@ -338,16 +760,16 @@ BL_API void *bl_priv_prev(register void *_ptr,
                           register const blsize _prev_size,
                           register const blsize _prev_align)
 {
-#if defined BL_DEBUG && !defined BL_PRIV_IASSERT
-#if BL_DEBUG >= 2
-	BL_ASSERT(_ptr != NULL && "`ptr` can't be NULL");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_ptr != NULL && "`ptr` can't be NULL");
 #endif
-#if BL_DEBUG >= 1
-	BL_ASSERT(_prev_size > 0 && _prev_size <= SIZE_MAX
-	          && "`prev_size` must be in (0, SIZE_MAX]");
-	BL_ASSERT(_prev_align > 0 && "`prev_align` must be a power of 2");
-	BL_ASSERT(((size_t)_prev_align & ((size_t)_prev_align - 1)) == 0
-	          && "`prev_align` must be a power of 2");
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_prev_size > 0 && _prev_size <= SIZE_MAX
+	               && "`prev_size` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_prev_align > 0 && "`prev_align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_prev_align & ((size_t)_prev_align - 1)) == 0
+	               && "`prev_align` must be a power of 2");
 #endif
 #endif
 	_ptr = (char *)_ptr - _prev_size;
@@ -367,12 +789,12 @@ BL_API void *bl_priv_memb(register void *const _obj,
                           register const blsize _size,
                           register const ptrdiff_t _idx)
 {
-#if defined BL_DEBUG && !defined BL_PRIV_IASSERT
-#if BL_DEBUG >= 2
-	BL_ASSERT(_obj != NULL && "`obj` can't be NULL");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_obj != NULL && "`obj` can't be NULL");
 #endif
-#if BL_DEBUG >= 1
-	BL_ASSERT(_size > 0 && "`size` must be in (0, SIZE_MAX]");
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_size > 0 && "`size` must be in (0, SIZE_MAX]");
 #endif
 #endif
 	return (char *)_obj + (ptrdiff_t)_size * _idx;
@@ -404,15 +826,15 @@ BL_API const void *bl_priv_nextc(register const void *_ptr,
                                  register const blsize _curr_size,
                                  register const blsize _next_align)
 {
-#if defined BL_DEBUG && !defined BL_PRIV_IASSERT
-#if BL_DEBUG >= 2
-	BL_ASSERT(_ptr != NULL && "`ptr` cannot be NULL");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_ptr != NULL && "`ptr` cannot be NULL");
 #endif
-#if BL_DEBUG >= 1
+#if BL_PRIV_CHECKS >= 1
 	/*BL_ASSERT(_curr_size >= 0);*/
-	BL_ASSERT(_next_align > 0 && "`next_align` must be a power of 2");
-	BL_ASSERT(((size_t)_next_align & ((size_t)_next_align - 1)) == 0
-	          && "`next_align` must be a power of 2");
+	BL_PRIV_ASSERT(_next_align > 0 && "`next_align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_next_align & ((size_t)_next_align - 1)) == 0
+	               && "`next_align` must be a power of 2");
 #endif
 #endif
 	_ptr = (const char *)_ptr + _curr_size;
@@ -433,16 +855,16 @@ BL_API const void *bl_priv_prevc(register const void *_ptr,
                                  register const blsize _prev_size,
                                  register const blsize _prev_align)
 {
-#if defined BL_DEBUG && !defined BL_PRIV_IASSERT
-#if BL_DEBUG >= 2
-	BL_ASSERT(_ptr != NULL && "`ptr` can't be NULL");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_ptr != NULL && "`ptr` can't be NULL");
 #endif
-#if BL_DEBUG >= 1
-	BL_ASSERT(_prev_size > 0 && _prev_size <= SIZE_MAX
-	          && "`prev_size` must be in (0, SIZE_MAX]");
-	BL_ASSERT(_prev_align > 0 && "`prev_align` must be a power of 2");
-	BL_ASSERT(((size_t)_prev_align & ((size_t)_prev_align - 1)) == 0
-	          && "`prev_align` must be a power of 2");
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_prev_size > 0 && _prev_size <= SIZE_MAX
+	               && "`prev_size` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_prev_align > 0 && "`prev_align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_prev_align & ((size_t)_prev_align - 1)) == 0
+	               && "`prev_align` must be a power of 2");
 #endif
 #endif
 	_ptr = (const char *)_ptr - _prev_size;
@@ -461,12 +883,12 @@ BL_API const void *bl_priv_membc(register const void *const _obj,
                                  register const blsize _size,
                                  register const ptrdiff_t _idx)
 {
-#if defined BL_DEBUG && !defined BL_PRIV_IASSERT
-#if BL_DEBUG >= 2
-	BL_ASSERT(_obj != NULL && "`obj` can't be NULL");
+#if BL_PRIV_CHECKS >= 1 && !defined BL_PRIV_IASSERT
+#if defined BL_DEBUG && BL_DEBUG >= 2
+	BL_PRIV_ASSERT(_obj != NULL && "`obj` can't be NULL");
 #endif
-#if BL_DEBUG >= 1
-	BL_ASSERT(_size > 0 && "`size` must be in (0, SIZE_MAX]");
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_size > 0 && "`size` must be in (0, SIZE_MAX]");
 #endif
 #endif
 	return (const char *)_obj + (ptrdiff_t)_size * _idx;
@@ -477,63 +899,66 @@ BL_API const void *bl_priv_membc(register const void *const _obj,
 #if !defined BL_PRIV_IASSERT
 
 #define blcalc(align, offs, n, lays, prev_size) \
-	bl_priv_calc(align, offs, n, lays, prev_size)
+	BL_PRIV_CALC(align, offs, n, lays, prev_size)
 #define blnextc(ptr, curr_size, next_align) \
 	bl_priv_nextc(ptr, curr_size, next_align)
 #define blprevc(ptr, prev_size, prev_align) \
 	bl_priv_nextc(ptr, prev_size, prev_align)
 #define blmembc(obj, size, idx) bl_priv_membc(obj, size, idx)
 
-#if defined __GNUC__ && (!defined BL_DEBUG || BL_DEBUG == 0)
+#if defined __GNUC__ && BL_PRIV_CHECKS == 0
 __attribute__((__const__))
 #endif
 BL_PRIV_INLINE_ALWAYS
 BL_API blsize blaligned(register const blsize _size,
                         register const blsize _align)
 {
-#if defined BL_DEBUG && BL_DEBUG >= 1
-	BL_ASSERT(_size > 0 && _size <= SIZE_MAX
-	          && "`size` must be in (0, SIZE_MAX]");
-	BL_ASSERT(_align > 0 && "`align` must be a power of 2");
-	BL_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
-	          && "`align` must be a power of 2");
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_size > 0 && _size <= SIZE_MAX
+	               && "`size` must be in (0, SIZE_MAX]");
+	BL_PRIV_ASSERT(_align > 0 && "`align` must be a power of 2");
+	BL_PRIV_ASSERT(((size_t)_align & ((size_t)_align - 1)) == 0
+	               && "`align` must be a power of 2");
 #endif
 	register const size_t _r =
 		(size_t) BLALIGNED((size_t)_size, (size_t)_align);
-#if defined BL_DEBUG && BL_DEBUG >= 1
-	BL_ASSERT(_r >= (size_t)_size && "detected wrap-around in `blaligned()`");
-	BL_ASSERT(_r <= (size_t)BL_SIZEMAX
-	          && "`blaligned()` result can't fit in `blsize`");
+#if BL_PRIV_CHECKS >= 1
+	BL_PRIV_ASSERT(_r >= (size_t)_size && "detected wrap-around in `blaligned()`");
+	BL_PRIV_ASSERT(_r <= (size_t)BL_SIZEMAX
+	               && "`blaligned()` result can't fit in `blsize`");
 #endif
 	return (blsize)_r;
 }
 
 #ifdef __GNUC__
-BL_PRIV_ATTR(__nonnull__(1)) __attribute__((__pure__))
+BL_PRIV_ATTR(__nonnull__(1))
+#if BL_PRIV_CHECKS == 0
+__attribute__((__pure__))
+#endif
 #endif
 BL_PRIV_INLINE_ALWAYS
 BL_API blsize blsizeof(register const struct blayout *const _l)
 {
 #if defined BL_DEBUG && BL_DEBUG >= 2
-	BL_ASSERT(_l != NULL && "`l` cannot be NULL");
+	BL_PRIV_ASSERT(_l != NULL && "`l` cannot be NULL");
 #endif
 	{
 		register const blsize _nmemb = _l->nmemb;
-#if defined BL_DEBUG && BL_DEBUG >= 1
-		BL_ASSERT(_nmemb > 0 && _nmemb <= SIZE_MAX
-		          && "layout `.nmemb` must be in (0, SIZE_MAX]");
+#if BL_PRIV_CHECKS >= 1
+		BL_PRIV_ASSERT(_nmemb > 0 && _nmemb <= SIZE_MAX
+		               && "layout `.nmemb` must be in (0, SIZE_MAX]");
 #endif
 		{
 			register const blsize _size = _l->size;
-#if defined BL_DEBUG && BL_DEBUG >= 1
-			BL_ASSERT(_size > 0 && _size <= SIZE_MAX
-			          && "layout `.size` must be in (0, SIZE_MAX]");
-			BL_ASSERT(!(_nmemb > BL_SIZEMAX / _size)
-			          && "object layout is too large");
-			BL_ASSERT(_l->align > 0
-			          && "layout alignment must be a power of 2");
-			BL_ASSERT(((size_t)_l->align & ((size_t)_l->align - 1)) == 0
-			          && "layout alignment must be a power of 2");
+#if BL_PRIV_CHECKS >= 1
+			BL_PRIV_ASSERT(_size > 0 && _size <= SIZE_MAX
+			               && "layout `.size` must be in (0, SIZE_MAX]");
+			BL_PRIV_ASSERT(!(_nmemb > BL_SIZEMAX / _size)
+			               && "object layout is too large");
+			BL_PRIV_ASSERT(_l->align > 0
+			               && "layout alignment must be a power of 2");
+			BL_PRIV_ASSERT(((size_t)_l->align & ((size_t)_l->align - 1)) == 0
+			               && "layout alignment must be a power of 2");
 #endif
 			return _nmemb * _size;
 		}
@@ -635,7 +1060,7 @@ BL_API blsize blsizeof(register const struct blayout *const _l)
     BL_PRIV_STMT_EXPR_RET_SUB                                         \
     BL_PRIV_STMT_EXPR_BEGIN_SUB                                       \
     register const blsize _bl_priv_prev_size = (prev_size);           \
-    BL_PRIV_STMT_EXPR_RET bl_priv_calc(_bl_priv_align,                \
+    BL_PRIV_STMT_EXPR_RET BL_PRIV_CALC(_bl_priv_align,                \
                                        _bl_priv_offs,                 \
                                        _bl_priv_n,                    \
                                        _bl_priv_lays,                 \
@@ -983,5 +1408,7 @@ BL_API blsize blsizeof(register const struct blayout *const _l)
 #endif
 #undef BL_PRIV_INLINE_USER
 #undef BL_PRIV_ATTR
+#undef BL_PRIV_ASSERT
+#undef BL_PRIV_CHECKS
 
 #endif  /* BLAYOUT_H */
@@ -58,6 +58,12 @@ struct blayout {
 	blsize size;
 	blsize align;
 };
+
+struct blayout32 {
+	uint32_t nmemb;
+	uint32_t size;
+	uint32_t align;
+};
 ```
 * `bluptr` is used internally to cast `void *` pointers to an integer type, where arithmetic may be performed. This is required for returning properly aligned pointers and such. Since the default, `uintptr_t`, is only available from C99 onwards, this `typedef` is provided to ease porting when using an earlier C standard and/or implementations where such a type is not offered. The header assumes that casting a `void *` pointer to `uintptr_t` leaves the bits unchanged or zero-extends, in case the latter is wider. A round-trip conversion, using the types above, is guaranteed by the C standard to result to a pointer referencing the same object as the original pointer. These semantics match the implementations offered by [GCC](https://gcc.gnu.org/onlinedocs/gcc/Arrays-and-pointers-implementation.html) and Clang.
 * `blsize` is the API's size type. It's `size_t` by default. You may change this type by modifying BLayout's header. A `signed` type is also valid. You'd have to change `BL_SIZEMAX` accordingly (see [below](#constants)).
@@ -65,6 +71,7 @@ struct blayout {
   - `nmemb` is the number of elements this object will hold (like `calloc()`'s first argument),
   - `size` is the size (in bytes) of each element/type (like `calloc()`'s second argument),
   - `align` is the alignment[^1] of the object's type
+* `blayout32` is a compact `blayout`, for when you keep large tables of descriptors around and none of them needs a field wider than $32$ bits. It's half the size of `blayout` on 64-bit targets, so twice as many fit in a cache line. Only `blcalc32()` and `blsizeof32()` take it (see [below](#functions)); its fields can be passed to every other function as they are.
 
 ## Constants
 ```c
@@ -83,6 +90,9 @@ Pagebreak
 #define BL_INLINE inline
 #define BL_DEBUG  0
 #define BL_CONST  0
+#define BL_STATS  0
+#define BL_LEAN   0
+#define BL_SAMPLE 0
 ```
 * `BL_API` is currently only used as a visual aid, do **not** try to change it.
 * BLayout can use assertions through the `BL_ASSERT` macro to enforce API contracts and prevent footguns. You can override this macro if you use a custom `assert()` function. See `BL_DEBUG` below if you want to disable assertions.
@@ -97,6 +107,9 @@ Pagebreak
   - $1$, where BLayout will include `const`-aware functions (`blnextc()`, `blprevc()`; see [below](#functions)).
   - $2$, where BLayout will change `blnext()` and `blprev()` to automatically and correctly handle the `const`-qualified case of input pointers, as well as the non-qualified case.
   - $3$, where the behavior is identical to $2$, but also compatible with the `-Wcast-qual` warning offered by [GCC](https://gcc.gnu.org/onlinedocs/gcc-15.1.0/gcc/Warning-Options.html#index-Wcast-qual) and [Clang](https://clang.llvm.org/docs/DiagnosticsReference.html#wcast-qual).
+* `BL_STATS` can be defined to $1$ to have every `blcalc()` call site count how often it's called, how many bytes it requested (net of `prev_size`), how many of those went to padding and how many calls failed. It's not defined by default, in which case `blcalc()` is unchanged and costs nothing extra. When enabled, `<stdio.h>` is included, the telemetry functions (see [below](#functions)) become available and each call site gets a `static` counter block that's updated with relaxed atomics. It's only supported under GCC and Clang compilers.
+* `BL_LEAN` can be defined to $1$ to trade some diagnostics for lighter macro expansion, which matters for compile times in translation units with thousands of call sites. It's not defined by default, and it only makes a difference with `BL_DEBUG` defined to $3$: the behavior is then identical to $2$, meaning that arguments are no longer checked at compile time, and no statement expressions (or, under C++, lambdas) are used. Results, annotations and run-time assertions are unchanged. See `tools/compile-bench.c` to measure the difference.
+* `BL_SAMPLE` can be defined to $N \geq 1$ to keep the checks of `BL_DEBUG` $1$ in release builds, at a fraction of the cost: each thread evaluates only about one in $N$ of them, chosen by a randomized countdown, and every other check costs a decrement and a branch. A failed check doesn't abort; it's counted and reported to a hook (see [below](#functions)), and the function then carries on as it would with `BL_DEBUG` defined to $0$. It's not defined by default. It requires `BL_DEBUG` to be $0$ (or undefined), ignores `BL_ASSERT` and is only supported under GCC and Clang compilers.
 Pagebreak
 ## Functions
 _Note: Reading the [terminology](#terminology) section first might clear up some terms that are used in the descriptions below._
@@ -112,10 +125,45 @@ BL_API void *blprev(void *ptr, blsize prev_size, blsize prev_align);
 
 BL_API blsize blsizeof(const struct blayout *l);
 
+BL_API blsize blcalc32(blsize align,
+                       ptrdiff_t offs,
+                       blsize n,
+                       const struct blayout32 *lays,
+                       blsize prev_size);
+BL_API blsize blsizeof32(const struct blayout32 *l);
+
+BL_API void   blbuild_init(struct blbuild *b, blsize align, ptrdiff_t offs);
+BL_API blsize blextend(struct blbuild *b, blsize nmemb, blsize size, blsize align);
+BL_API void   blpad_to_align(struct blbuild *b);
+BL_API blsize blfinish(const struct blbuild *b, blsize *max_align);
+
 #if BL_CONST >= 1
 BL_API const void *blnextc(const void *ptr, blsize curr_size, blsize next_align);
 BL_API const void *blprevc(const void *ptr, blsize prev_size, blsize prev_align);
 #endif
+
+#if BL_STATS >= 1
+struct blstats {
+	const char *file;
+	const char *func;
+	long line;
+	unsigned long long calls, bytes, padding, failures;
+	/* ... */
+};
+
+BL_API void blstats_foreach(void (*fn)(void *ctx, const struct blstats *s),
+                            void *ctx);
+BL_API void blstats_reset(void);
+BL_API void blstats_dump(FILE *f);
+#endif
+
+#if BL_SAMPLE >= 1
+typedef void blsample_hook(const char *expr, const char *file, long line,
+                           const char *func);
+
+BL_API blsample_hook *blsample_set_hook(blsample_hook *hook);
+BL_API unsigned long long blsample_failures(void);
+#endif
 ```
 * `blcalc()` returns the minimum size needed to contiguously lay out multiple objects. The function assumes that all arguments are valid and within bounds. If wrap-around is detected when computing the size, $0$ is returned instead.
   - `align` is the default Alignment your allocator supports. In case you already have an allocated block, pass the block's alignment. `BL_ALIGNMENT` should be compatible with the default alignment of every memory block allocated by `malloc()` and every naturally-aligned[^2] type.
@@ -135,7 +183,20 @@ BL_API const void *blprevc(const void *ptr, blsize prev_size, blsize prev_align)
   - `l` is the pointer to the aforementioned layout.
   1. _Caveat: Padding due to alignment is **not** taken into account._
   2. _Caveat: Potential integer overflow is **not** checked. The layout is assumed to be correct. `blcalc()` already checks for this._
+* `blcalc32()` and `blsizeof32()` are identical to `blcalc()` and `blsizeof()`, but take `blayout32` descriptors. `blcalc32()` gives the same result and the same overflow guarantees as `blcalc()` for equal layouts, and the result may be chained with either. `blcalc32()` isn't counted by `BL_STATS`.
+* `blbuild_init()`, `blextend()`, `blpad_to_align()` and `blfinish()` compute the same size as `blcalc()`, with the same overflow checks, one region at a time, for when the regions aren't all known up front. `struct blbuild` holds the state and should be treated as opaque. Errors are sticky: once one is detected, `blextend()` returns $0$ and `blfinish()` fails.
+  - `blbuild_init()` starts a new layout. `align` and `offs` are the same as `blcalc()`'s.
+  - `blextend()` appends a region of `nmemb` elements of `size` bytes and Alignment `align`, and returns its offset from `block + offs`. The offset is the one `blnext()` would give the region, as long as `align` doesn't exceed the block's alignment; otherwise, lay out with `blnext()`.
+  - `blpad_to_align()` pads the size so far to a multiple of the largest Alignment so far, so that every region stays aligned in an array of such blocks.
+  - `blfinish()` returns the total size, or $0$ on error. The largest Alignment among the regions is stored into `*max_align`, unless `max_align` is `NULL`.
 * `blnextc()` and `blprevc()` have identical behavior to `blnext()` and `blprev()` respectively. They are _not_ included if `BL_CONST` is undefined or has a value of $0$. They return and take a `const`-qualified pointer. Remember also that `blnext()` and `blprev()` can automatically preserve `const`-correctness if `BL_CONST` is defined to a value of $2$ or $3$.
+* `blstats_foreach()`, `blstats_reset()` and `blstats_dump()` are _only_ included if `BL_STATS` is defined to $1$. A call site shows up once it has been reached at least once; call sites from every translation unit share a single list.
+  - `blstats_foreach()` calls `fn` with `ctx` for every call site. The counters may be read while other threads keep calling `blcalc()`, but they aren't a consistent snapshot.
+  - `blstats_reset()` zeroes the counters of every call site.
+  - `blstats_dump()` prints one line per call site to `f`, along with the percentage of requested bytes that went to padding.
+* `blsample_set_hook()` and `blsample_failures()` are _only_ included if `BL_SAMPLE` is defined to $1$ or more. Both are shared by every translation unit and thread.
+  - `blsample_set_hook()` sets the function that's called with the text, file, line and function of every failed check, and returns the previous one. Pass `NULL` to only count failures, which is the default. The hook may be called concurrently, from any thread.
+  - `blsample_failures()` returns the number of failed checks so far.
 
 Keep in mind that the signatures above are for reference. The actual implementation may significantly differ. For example, some functions may be implemented as a macro, meaning that you can't take their address. However, it's guaranteed that all arguments will be evaluated, and each will be evaluated once. Further, you can be assured that your lexical scope won't be polluted.
 Pagebreak
@@ -103,11 +103,19 @@ AM_API void *aligned_malloc(size_t alignment, size_t size)
 		{1, size, alignment}
 	};
 	size_t req = blcalc(BL_ALIGNMENT, 0, 2, l, 0);
-	if (AM_UNLIKELY(req == 0)) {
+	/*
+	 * `blcalc()` pads as if the block sat exactly at a `BL_ALIGNMENT`
+	 * boundary, but `malloc()` may return one that's aligned to anything
+	 * between that and `alignment`. Account for the worst case.
+	 */
+	size_t slack = alignment > BL_ALIGNMENT ? alignment - BL_ALIGNMENT : 0;
+	if (AM_UNLIKELY(req == 0 || req + slack < req)) {
 		err = ENOMEM;
 		goto error;
 	}
 
+	req += slack;
+
 	void *blk = malloc(req);
 	if (AM_UNLIKELY(blk == NULL))
 		goto error_malloc;
@@ -0,0 +1,174 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Lock-free placement of records inside one shared block, for threads that
+ * append to the same output concurrently. Instead of a mutex around a
+ * `blnext()` cursor, the cursor is an atomic offset into the block.
+ *
+ * `ab_alloc()` reserves with a single `fetch_add`. It can't know where the
+ * cursor will be when its addition lands, so it reserves for the worst case:
+ * `align - AB_GRAIN` extra bytes, when `align > AB_GRAIN`, out of which the
+ * record is then aligned with `blnext()`. Every reservation is rounded up to a
+ * multiple of `AB_GRAIN`, and the block must be `AB_GRAIN`-aligned, so
+ * records aligned to `AB_GRAIN` or less never waste anything else.
+ *
+ * `ab_alloc_exact()` computes the padding for the current cursor, exactly
+ * like `blnext()`, and publishes it with a compare-and-swap, retrying if
+ * another thread got there first. Nothing is wasted beyond the rounding to
+ * `AB_GRAIN`, but under heavy contention the retries add up. The two can be
+ * mixed freely.
+ *
+ * Once the block is full, a reservation fails and returns NULL. The cursor is
+ * never moved back, so every reservation after that fails too, even a smaller
+ * one that would have fit: `ab_alloc()` has already moved it past the end. The
+ * records handed out so far stay valid; `ab_used()` tells how far they go.
+ *
+ * Only the space is synchronized (with relaxed atomics): publishing the
+ * contents of a record to other threads is up to the caller.
+ *
+ * Uses GCC/Clang `__atomic` builtins. Everything is `static inline`. Example
+ * usage:
+ * ```c
+ * #define AB_GRAIN 16         // Optional; defaults to 8.
+ * #include "atomic-bump.h"    // struct ab_arena, ab_*()
+ *
+ * struct ab_arena a;
+ * ab_init(&a, block, size);  // `block` must be `AB_GRAIN`-aligned.
+ *
+ * // On any thread:
+ * char *rec = ab_alloc_record(&a, 3, lays);
+ * if (rec == NULL)
+ *     return 1;  // Full.
+ *
+ * uint32_t *hdr  = blnext(rec,                      0, lays[0].align);
+ * char     *name = blnext(hdr,   blsizeof(&lays[0]), lays[1].align);
+ * double   *vals = blnext(name,  blsizeof(&lays[1]), lays[2].align);
+ * ```
+ */
+
+#ifndef AB_H
+#define AB_H
+
+/* struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <stddef.h>  /* size_t, NULL */
+
+#if !defined __GNUC__
+#	error "`atomic-bump.h` requires GCC or Clang `__atomic` builtins"
+#endif
+
+/* Granularity of reservations; a power of 2. */
+#ifndef AB_GRAIN
+#	define AB_GRAIN 8
+#endif
+
+#define AB_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+struct ab_arena {
+	char *base;
+	size_t cap;
+	size_t pos;  /* Accessed atomically; may end up past `cap`. */
+};
+
+static inline void ab_init(struct ab_arena *a, void *base, size_t cap)
+{
+	a->base = (char *)base;
+	a->cap = cap & ~(size_t)(AB_GRAIN - 1);
+	a->pos = 0;
+}
+
+/* Not thread-safe: nobody else may be allocating. */
+static inline void ab_reset(struct ab_arena *a)
+{
+	__atomic_store_n(&a->pos, 0, __ATOMIC_RELAXED);
+}
+
+/* Bytes handed out (or wasted on padding) so far. */
+static inline size_t ab_used(const struct ab_arena *a)
+{
+	size_t pos = __atomic_load_n(&a->pos, __ATOMIC_RELAXED);
+	return pos < a->cap ? pos : a->cap;
+}
+
+/* Rounds `bytes` up to `AB_GRAIN`; 0 on overflow. */
+static inline size_t ab_round(size_t bytes)
+{
+	size_t r = (bytes + (AB_GRAIN - 1)) & ~(size_t)(AB_GRAIN - 1);
+	return r < bytes ? 0 : r;
+}
+
+/*
+ * Reserves `bytes` bytes aligned to `align`, a power of 2, with a single
+ * atomic addition. Returns NULL if the block is full.
+ */
+static inline void *ab_alloc(struct ab_arena *a, size_t bytes, size_t align)
+{
+	size_t slack = align > AB_GRAIN ? align - AB_GRAIN : 0;
+	size_t need = ab_round(bytes + slack);
+	size_t old;
+	if (AB_UNLIKELY(need == 0 || need > a->cap))
+		return NULL;
+
+	/*
+	 * Fail early once full, so that failed reservations don't keep pushing
+	 * the cursor further: it can't overflow as long as fewer than
+	 * `SIZE_MAX / cap` threads race past the end at once.
+	 */
+	if (AB_UNLIKELY(__atomic_load_n(&a->pos, __ATOMIC_RELAXED) > a->cap - need))
+		return NULL;
+
+	old = __atomic_fetch_add(&a->pos, need, __ATOMIC_RELAXED);
+	if (AB_UNLIKELY(old > a->cap - need))
+		return NULL;
+
+	return blnext(a->base + old, 0, align);
+}
+
+/*
+ * Like `ab_alloc()`, but pads only as much as the cursor actually needs,
+ * retrying with a compare-and-swap under contention.
+ */
+static inline void *ab_alloc_exact(struct ab_arena *a, size_t bytes,
+                                   size_t align)
+{
+	size_t old = __atomic_load_n(&a->pos, __ATOMIC_RELAXED);
+	size_t start, end;
+	do {
+		if (AB_UNLIKELY(old >= a->cap))
+			return NULL;
+
+		start = (size_t)((char *)blnext(a->base + old, 0, align) - a->base);
+		end = ab_round(start + bytes);
+		if (AB_UNLIKELY(start < old || end < start || end > a->cap))
+			return NULL;
+	} while (!__atomic_compare_exchange_n(&a->pos, &old, end, 1,
+	                                      __ATOMIC_RELAXED,
+	                                      __ATOMIC_RELAXED));
+	return a->base + start;
+}
+
+/*
+ * Reserves room for a record made of the `n` regions in `lays`, laid out as
+ * by `blcalc()`, and returns its start, to walk with `blnext()`; NULL if the
+ * block is full.
+ */
+static inline void *ab_alloc_record(struct ab_arena *a, size_t n,
+                                    const struct blayout *lays)
+{
+	size_t align = 1;
+	size_t size, i;
+	for (i = 0; i < n; ++i)
+		if (lays[i].align > align)
+			align = lays[i].align;
+
+	size = blcalc(align, 0, n, lays, 0);
+	if (AB_UNLIKELY(size == 0))
+		return NULL;
+
+	return ab_alloc(a, size, align);
+}
+
+#undef AB_UNLIKELY
+
+#endif  /* AB_H */
@@ -0,0 +1,645 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Loads many blocks written by `blio_writeblk()` at once, overlapping their
+ * reads instead of waiting for each in turn.
+ *
+ * `batch_load()` first sizes every block with `blcalc()` and places them all
+ * in one allocation, so that nothing is allocated per block and every region
+ * pointer is known before any I/O. It then keeps up to `depth` reads in
+ * flight through an `io_uring` instance, set up with raw system calls (no
+ * liburing), submitting and reaping them in batches: one `io_uring_enter()`
+ * per batch instead of one `preadv()` per block. Where `io_uring` isn't
+ * available (old kernels, seccomp filters, `io_uring_disabled`), a few
+ * threads call `blio_readv()` instead, which still overlaps the reads, if
+ * not the system calls.
+ *
+ * Either way, the callback is called from the calling thread, once per
+ * block, as soon as the block has arrived, in whatever order the reads
+ * complete. Short reads are resumed; a block that ends early fails with
+ * `EIO`, on its own.
+ *
+ * Requires Linux, `<linux/io_uring.h>`, `syscall()` and `preadv()`
+ * (`_DEFAULT_SOURCE` under glibc), and POSIX threads. Uses `blio.h`, and
+ * includes its implementation too unless it's already been included.
+ * Implemented as a "header library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define BATCH_API static  // Fine if used in a single translation unit.
+ * #define BATCH_IMPL        // Include the implementation here.
+ * #include "batch-load.h"   // struct batch_loader, struct batch_req, batch_*()
+ *
+ * static void ready(void *ctx, struct batch_req *r)
+ * {
+ *     if (r->err == 0)
+ *         index_entity(ctx, r->regions[0], r->regions[1]);
+ * }
+ *
+ * struct batch_loader l;
+ * batch_init(&l, 0, 0);
+ *
+ * for (size_t i = 0; i < n; ++i) {
+ *     reqs[i].fd = fd;
+ *     reqs[i].off = offs[i];  // Where `blio_writeblk()` wrote block `i`.
+ *     reqs[i].n = 2;
+ *     reqs[i].lays = lays[i];
+ *     reqs[i].regions = regions[i];
+ * }
+ * void *all = batch_load(&l, reqs, n, BL_ALIGNMENT, BLIO_SKIP_PADDING,
+ *                        ready, ctx);
+ * if (all == NULL)
+ *     return 1;
+ *
+ * // ...
+ * free(all);
+ * batch_destroy(&l);
+ * ```
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "blayout.h"   /* struct blayout */
+#include <stddef.h>    /* size_t */
+#include <sys/types.h> /* off_t */
+
+#ifndef BATCH_API
+#	define BATCH_API
+#endif
+
+/* Reads in flight when `batch_init()` is given 0. */
+#ifndef BATCH_DEPTH
+#	define BATCH_DEPTH 256
+#endif
+
+/* Threads reading when `io_uring` isn't available. */
+#ifndef BATCH_THREADS
+#	define BATCH_THREADS 16
+#endif
+
+enum batch_flags {
+	BATCH_NO_URING = 1  /* Always use the fallback. */
+};
+
+struct batch_ring;
+
+struct batch_loader {
+	struct batch_ring *ring;  /* NULL if using the fallback. */
+	unsigned depth;
+};
+
+struct batch_req {
+	int fd;
+	off_t off;                   /* Where the block starts; not negative. */
+	size_t n;
+	const struct blayout *lays;
+	void **regions;              /* If not NULL, room for `n` pointers. */
+	void *block;                 /* Set by `batch_load()`. */
+	int err;                     /* 0 or an error number, once it's done. */
+};
+
+/* `r->block` (and `r->regions`) are ready, unless `r->err` is set. */
+typedef void batch_done_fn(void *ctx, struct batch_req *r);
+
+/*
+ * Sets up `io_uring` with room for `depth` reads in flight (`BATCH_DEPTH` if
+ * 0), or the fallback if that fails or if `flags` has `BATCH_NO_URING`.
+ */
+BATCH_API void batch_init(struct batch_loader *l, unsigned depth, int flags);
+BATCH_API void batch_destroy(struct batch_loader *l);
+
+/*
+ * Reads the `nreqs` blocks of `reqs`, written with `blio_writeblk()` and
+ * `flags`, into one allocation holding all of them, each aligned to `align`
+ * or to the largest alignment among all the layouts, whichever is larger,
+ * that must be freed with `free()`, and calls `fn` (if not NULL) for each as
+ * it arrives. Returns the allocation, even if some reads failed, or NULL with
+ * `errno` set if there was nothing to read into.
+ */
+BATCH_API void *batch_load(struct batch_loader *l, struct batch_req *reqs,
+                           size_t nreqs, size_t align, int flags,
+                           batch_done_fn *fn, void *ctx);
+
+#endif  /* BATCH_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef BATCH_IMPL
+
+#ifndef BLIO_H
+#	ifdef __GNUC__
+#		define BLIO_API static __attribute__((__unused__))  /* Not all used. */
+#	else
+#		define BLIO_API static
+#	endif
+#	define BLIO_IMPL
+#endif
+#include "blio.h"            /* blio_iov(), blio_readv() */
+/* struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+/* errno, EINTR, EAGAIN, EBUSY, EINVAL, EIO, ENOMEM */
+#include <errno.h>
+#include <limits.h>          /* IOV_MAX */
+#include <linux/io_uring.h>  /* struct io_uring_*, IORING_* */
+#include <pthread.h>         /* pthread_*() */
+#include <stdint.h>          /* uint64_t, uintptr_t */
+#include <stdlib.h>          /* malloc(), free(), posix_memalign() */
+#include <string.h>          /* memset() */
+#include <sys/mman.h>        /* mmap(), munmap() */
+#include <sys/syscall.h>     /* SYS_io_uring_setup, SYS_io_uring_enter */
+#include <sys/uio.h>         /* struct iovec */
+#include <unistd.h>          /* syscall(), close() */
+
+#ifndef IOV_MAX
+#	define IOV_MAX 16  /* The lowest POSIX allows. */
+#endif
+
+#ifdef __GNUC__
+#	define BATCH_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#	define BATCH_UNLIKELY(x) (x)
+#endif
+
+struct batch_ring {
+	int fd;
+	unsigned entries;
+	void *sq_map;
+	void *cq_map;
+	size_t sq_len;
+	size_t cq_len;
+	struct io_uring_sqe *sqes;
+	unsigned *sq_head;   /* Moved by the kernel. */
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;   /* Moved by the kernel. */
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+enum batch_state {
+	BATCH_PENDING,
+	BATCH_QUEUED,
+	BATCH_DONE
+};
+
+/* What's left to read of one block. */
+struct batch_slot {
+	struct iovec *iov;
+	size_t cnt;
+	size_t left;
+	off_t off;
+	enum batch_state state;
+};
+
+struct batch_job {
+	struct batch_req *reqs;
+	struct batch_slot *slots;
+	size_t nreqs;
+	batch_done_fn *fn;
+	void *ctx;
+	/* For the fallback. */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	size_t next;         /* Next block to read. */
+	size_t *done;        /* Blocks read, but not passed to `fn` yet. */
+	size_t ndone;
+	int waiting;         /* Whether the caller waits for `cond`. */
+};
+
+static void batch_ring_free(struct batch_ring *r)
+{
+	munmap(r->sqes, r->entries * sizeof *r->sqes);
+	if (r->cq_map != r->sq_map)
+		munmap(r->cq_map, r->cq_len);
+	munmap(r->sq_map, r->sq_len);
+	close(r->fd);
+	free(r);
+}
+
+static struct batch_ring *batch_ring_new(unsigned depth)
+{
+	struct io_uring_params p;
+	struct batch_ring *r = malloc(sizeof *r);
+	char *sq, *cq;
+	void *sqes;
+	if (BATCH_UNLIKELY(r == NULL))
+		return NULL;
+
+	memset(&p, 0, sizeof p);
+	r->fd = (int)syscall(SYS_io_uring_setup, depth, &p);
+	if (r->fd < 0) {
+		free(r);
+		return NULL;
+	}
+
+	r->entries = p.sq_entries;
+	r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_len > r->sq_len)
+			r->sq_len = r->cq_len;
+		r->cq_len = r->sq_len;
+	}
+
+	r->sq_map = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+	                 r->fd, IORING_OFF_SQ_RING);
+	if (BATCH_UNLIKELY(r->sq_map == MAP_FAILED))
+		goto error;
+
+	r->cq_map = r->sq_map;
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+		r->cq_map = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+		                 MAP_SHARED, r->fd, IORING_OFF_CQ_RING);
+		if (BATCH_UNLIKELY(r->cq_map == MAP_FAILED))
+			goto error_sq;
+	}
+
+	sqes = mmap(NULL, r->entries * sizeof *r->sqes, PROT_READ | PROT_WRITE,
+	            MAP_SHARED, r->fd, IORING_OFF_SQES);
+	if (BATCH_UNLIKELY(sqes == MAP_FAILED))
+		goto error_cq;
+
+	sq = r->sq_map;
+	cq = r->cq_map;
+	r->sqes = sqes;
+	r->sq_head = (unsigned *)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)(sq + p.sq_off.array);
+	r->cq_head = (unsigned *)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return r;
+
+error_cq:
+	if (r->cq_map != r->sq_map)
+		munmap(r->cq_map, r->cq_len);
+error_sq:
+	munmap(r->sq_map, r->sq_len);
+error:
+	close(r->fd);
+	free(r);
+	return NULL;
+}
+
+static int batch_enter(struct batch_ring *r, unsigned submit, unsigned wait)
+{
+	return (int)syscall(SYS_io_uring_enter, r->fd, submit, wait,
+	                    IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+/* Queues a read of what's left of block `i`. */
+static void batch_queue(struct batch_ring *r, struct batch_slot *s, int fd,
+                        size_t i)
+{
+	const unsigned tail = *r->sq_tail;
+	const unsigned idx = tail & *r->sq_mask;
+	struct io_uring_sqe *sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof *sqe);
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = fd;
+	sqe->off = (uint64_t)s->off;
+	sqe->addr = (uint64_t)(uintptr_t)s->iov;
+	sqe->len = (unsigned)(s->cnt > IOV_MAX ? IOV_MAX : s->cnt);
+	sqe->user_data = i;
+	r->sq_array[idx] = idx;
+	s->state = BATCH_QUEUED;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Skips the `done` bytes just read. */
+static void batch_advance(struct batch_slot *s, size_t done)
+{
+	s->left -= done;
+	s->off += (off_t)done;
+	while (s->cnt > 0 && done >= s->iov->iov_len) {
+		done -= s->iov->iov_len;
+		++s->iov;
+		--s->cnt;
+	}
+	if (s->cnt > 0) {
+		s->iov->iov_base = (char *)s->iov->iov_base + done;
+		s->iov->iov_len -= done;
+	}
+}
+
+static void batch_finish(struct batch_job *j, size_t i, int err)
+{
+	j->slots[i].state = BATCH_DONE;
+	j->reqs[i].err = err;
+	if (j->fn != NULL)
+		j->fn(j->ctx, &j->reqs[i]);
+}
+
+/* Reads block `i` with `blio_readv()`; returns an error number. */
+static int batch_read(struct batch_job *j, size_t i)
+{
+	struct batch_slot *s = &j->slots[i];
+	const size_t want = s->left;
+	ssize_t r = blio_readv(j->reqs[i].fd, s->iov, s->cnt, s->off);
+	if (BATCH_UNLIKELY(r < 0))
+		return errno;
+
+	return (size_t)r == want ? 0 : EIO;
+}
+
+/*
+ * Handles the completions that have arrived, requeueing whatever is left to
+ * read unless `requeue` is 0. Returns how many reads are no longer in flight.
+ */
+static unsigned batch_reap(struct batch_ring *r, struct batch_job *j,
+                           unsigned *queued, int requeue)
+{
+	unsigned head = *r->cq_head;
+	const unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	unsigned gone = 0;
+	for (; head != tail; ++head) {
+		const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+		const size_t i = (size_t)cqe->user_data;
+		const int res = cqe->res;
+		struct batch_slot *s = &j->slots[i];
+		int more = 0, err = 0;
+		if (res > 0) {
+			batch_advance(s, (size_t)res);
+			more = s->left > 0;
+		} else if (res == 0) {
+			err = EIO;  /* The file ended early. */
+		} else if (-res == EINTR || -res == EAGAIN) {
+			more = 1;
+		} else {
+			err = -res;
+		}
+
+		if (more && requeue) {
+			batch_queue(r, s, j->reqs[i].fd, i);
+			++*queued;
+			continue;
+		}
+		++gone;
+		if (more)
+			s->state = BATCH_PENDING;  /* Read synchronously later. */
+		else
+			batch_finish(j, i, err);
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	return gone;
+}
+
+/*
+ * Forgets the reads queued since the last `io_uring_enter()`; the kernel
+ * only looks at the ring when entered. Returns how many there were.
+ */
+static unsigned batch_unqueue(struct batch_ring *r, struct batch_job *j)
+{
+	const unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+	unsigned tail = *r->sq_tail;
+	unsigned n = tail - head;
+	for (; tail != head; --tail) {
+		const unsigned idx = r->sq_array[(tail - 1) & *r->sq_mask];
+		j->slots[r->sqes[idx].user_data].state = BATCH_PENDING;
+	}
+	__atomic_store_n(r->sq_tail, head, __ATOMIC_RELEASE);
+	return n;
+}
+
+/* Returns 0, or -1 if reads may still be in flight. */
+static int batch_uring(struct batch_ring *r, struct batch_job *j)
+{
+	size_t next = 0, done = 0, i;
+	unsigned inflight = 0, queued = 0, gone;
+	while (done < j->nreqs) {
+		int n;
+		for (; next < j->nreqs && inflight < r->entries; ++next) {
+			batch_queue(r, &j->slots[next], j->reqs[next].fd, next);
+			++inflight;
+			++queued;
+		}
+
+		n = batch_enter(r, queued, 1);
+		if (n >= 0)
+			queued -= (unsigned)n;
+		else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			goto broken;
+
+		gone = batch_reap(r, j, &queued, 1);
+		inflight -= gone;
+		done += gone;
+	}
+	return 0;
+
+broken:
+	/* Let what was submitted land, then read the rest synchronously. */
+	inflight -= batch_unqueue(r, j);
+	queued = 0;
+	while (inflight > 0) {
+		if (BATCH_UNLIKELY(batch_enter(r, 0, 1) < 0 && errno != EINTR))
+			return -1;
+
+		inflight -= batch_reap(r, j, &queued, 0);
+	}
+	for (i = 0; i < j->nreqs; ++i) {
+		if (j->slots[i].state != BATCH_DONE)
+			batch_finish(j, i, batch_read(j, i));
+	}
+	return 0;
+}
+
+static void *batch_thread(void *arg)
+{
+	struct batch_job *j = arg;
+	for (;;) {
+		size_t i = __atomic_fetch_add(&j->next, 1, __ATOMIC_RELAXED);
+		int err;
+		if (i >= j->nreqs)
+			return NULL;
+
+		err = batch_read(j, i);
+		pthread_mutex_lock(&j->lock);
+		j->reqs[i].err = err;
+		j->done[j->ndone++] = i;
+		if (j->waiting) {
+			j->waiting = 0;
+			pthread_cond_signal(&j->cond);
+		}
+		pthread_mutex_unlock(&j->lock);
+	}
+}
+
+static void batch_threads(struct batch_job *j)
+{
+	pthread_t tids[BATCH_THREADS];
+	unsigned nthreads = 0, t;
+	size_t seen = 0;
+	pthread_mutex_init(&j->lock, NULL);
+	pthread_cond_init(&j->cond, NULL);
+	j->next = 0;
+	j->ndone = 0;
+	j->waiting = 0;
+	while (nthreads < BATCH_THREADS && nthreads < j->nreqs
+	       && pthread_create(&tids[nthreads], NULL, batch_thread, j) == 0)
+		++nthreads;
+	if (BATCH_UNLIKELY(nthreads == 0))
+		batch_thread(j);
+
+	/* Hand the blocks over as they come in. */
+	while (seen < j->nreqs) {
+		size_t until;
+		pthread_mutex_lock(&j->lock);
+		while (j->ndone == seen) {
+			j->waiting = 1;
+			pthread_cond_wait(&j->cond, &j->lock);
+		}
+		until = j->ndone;
+		pthread_mutex_unlock(&j->lock);
+
+		for (; seen < until; ++seen)
+			batch_finish(j, j->done[seen], j->reqs[j->done[seen]].err);
+	}
+
+	for (t = 0; t < nthreads; ++t)
+		pthread_join(tids[t], NULL);
+	pthread_cond_destroy(&j->cond);
+	pthread_mutex_destroy(&j->lock);
+}
+
+BATCH_API void batch_init(struct batch_loader *l, unsigned depth, int flags)
+{
+	l->depth = depth != 0 ? depth : BATCH_DEPTH;
+	l->ring = flags & BATCH_NO_URING ? NULL : batch_ring_new(l->depth);
+	if (l->ring != NULL)
+		l->depth = l->ring->entries;
+}
+
+BATCH_API void batch_destroy(struct batch_loader *l)
+{
+	if (l->ring != NULL)
+		batch_ring_free(l->ring);
+	l->ring = NULL;
+}
+
+BATCH_API void *batch_load(struct batch_loader *l, struct batch_req *reqs,
+                           size_t nreqs, size_t align, int flags,
+                           batch_done_fn *fn, void *ctx)
+{
+	struct batch_job j;
+	struct blayout bk[2];
+	struct iovec *iov;
+	void *all, *bookkeeping;
+	size_t total = 0, niov = 0, i, k;
+	int err;
+	if (BATCH_UNLIKELY(nreqs == 0 || align == 0
+	                   || (align & (align - 1)) != 0)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* Blocks are sized for, and placed at, the same alignment. */
+	if (align < sizeof(void *))
+		align = sizeof(void *);
+	for (i = 0; i < nreqs; ++i)
+		for (k = 0; k < reqs[i].n; ++k)
+			if (align < reqs[i].lays[k].align)
+				align = reqs[i].lays[k].align;
+
+	/* Size every block, before reading any. */
+	for (i = 0; i < nreqs; ++i) {
+		size_t size = reqs[i].n != 0 ? blcalc(align, 0, reqs[i].n,
+		                                      reqs[i].lays, 0)
+		                             : 0;
+		if (BATCH_UNLIKELY(size == 0 || reqs[i].off < 0)) {
+			errno = EINVAL;
+			return NULL;
+		}
+
+		total = (total + align - 1) & ~(align - 1);
+		if (BATCH_UNLIKELY(total + size < total || niov + reqs[i].n < niov)) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		total += size;
+		niov += reqs[i].n;
+	}
+
+	/* The slots and all the `iovec`s, in one block of their own. */
+	bk[0].nmemb = nreqs;
+	bk[0].size = sizeof *j.slots;
+	bk[0].align = BL_ALIGNMENT;
+	bk[1].nmemb = niov;
+	bk[1].size = sizeof *iov;
+	bk[1].align = BL_ALIGNMENT;
+	k = blcalc(BL_ALIGNMENT, 0, 2, bk, 0);
+	if (BATCH_UNLIKELY(k == 0)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	bookkeeping = malloc(k);
+	if (BATCH_UNLIKELY(bookkeeping == NULL))
+		return NULL;
+
+	j.done = malloc(nreqs * sizeof *j.done);
+	err = posix_memalign(&all, align, total);
+	if (BATCH_UNLIKELY(j.done == NULL || err != 0)) {
+		free(j.done);
+		free(bookkeeping);
+		errno = j.done == NULL ? ENOMEM : err;
+		return NULL;
+	}
+
+	j.reqs = reqs;
+	j.slots = blnext(bookkeeping, 0, bk[0].align);
+	j.nreqs = nreqs;
+	j.fn = fn;
+	j.ctx = ctx;
+	iov = blnext(j.slots, blsizeof(&bk[0]), bk[1].align);
+	for (total = 0, i = 0; i < nreqs; ++i) {
+		struct batch_slot *s = &j.slots[i];
+		struct batch_req *r = &reqs[i];
+		total = (total + align - 1) & ~(align - 1);
+		r->block = (char *)all + total;
+		r->err = 0;
+		total += blcalc(align, 0, r->n, r->lays, 0);
+		if (r->regions != NULL) {
+			char *p = r->block;
+			size_t prev_size = 0;
+			for (k = 0; k < r->n; ++k) {
+				p = blnext(p, prev_size, r->lays[k].align);
+				prev_size = blsizeof(&r->lays[k]);
+				r->regions[k] = p;
+			}
+		}
+
+		s->iov = iov;
+		s->cnt = blio_iov(iov, r->block, r->n, r->lays, flags);
+		s->off = r->off;
+		s->state = BATCH_PENDING;
+		for (s->left = 0, k = 0; k < s->cnt; ++k)
+			s->left += iov[k].iov_len;
+		iov += s->cnt;
+	}
+
+	if (l->ring != NULL && BATCH_UNLIKELY(batch_uring(l->ring, &j) != 0)) {
+		/* The kernel may still be using `all` and the `iovec`s; leak them. */
+		err = errno;
+		batch_ring_free(l->ring);
+		l->ring = NULL;
+		free(j.done);
+		errno = err;
+		return NULL;
+	}
+	if (l->ring == NULL)
+		batch_threads(&j);
+
+	free(j.done);
+	free(bookkeeping);
+	return all;
+}
+
+#undef BATCH_UNLIKELY
+
+#undef BATCH_IMPL
+#endif  /* BATCH_IMPL */
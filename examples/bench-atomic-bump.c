@@ -0,0 +1,173 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * 1 to 16 threads append heterogeneous records to one shared block, placing
+ * them with a mutex around a `blnext()` cursor, with `ab_alloc()` or with
+ * `ab_alloc_exact()`. Prints records per second and the bytes lost to
+ * padding.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -pthread -I.. bench-atomic-bump.c -o bench-atomic-bump
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "atomic-bump.h"  /* struct ab_arena, ab_*() */
+/* struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <pthread.h>      /* pthread_*() */
+#include <stdint.h>       /* uint32_t */
+#include <stdio.h>        /* printf() */
+#include <stdlib.h>       /* aligned_alloc(), free(), EXIT_* */
+#include <string.h>       /* memset() */
+#include <time.h>         /* clock_gettime() */
+
+#define MAX_THREADS 16
+#define RECORDS     (1 << 21)  /* Per measurement, over all threads. */
+#define KINDS       4
+#define CAP         ((size_t)RECORDS * 256)
+
+enum method {
+	MUTEX,
+	FETCH_ADD,
+	CAS
+};
+
+/* {header, name, values}: 4-byte, 1-byte and 8- or 32-byte aligned. */
+static struct blayout lays[KINDS][3];
+static size_t sizes[KINDS];
+static size_t payload;  /* Bytes of all records, without padding. */
+
+static struct ab_arena arena;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static char *cursor;  /* Under `lock`. */
+static size_t prev_size;
+
+struct worker {
+	pthread_t tid;
+	enum method m;
+	size_t first, count;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static char *place(enum method m, size_t k)
+{
+	char *rec;
+	switch (m) {
+	case MUTEX:
+		pthread_mutex_lock(&lock);
+		rec = blnext(cursor, prev_size, lays[k][2].align);
+		if (rec + sizes[k] > arena.base + arena.cap) {
+			rec = NULL;
+		} else {
+			cursor = rec;
+			prev_size = sizes[k];
+		}
+		pthread_mutex_unlock(&lock);
+		return rec;
+	case FETCH_ADD:
+		return ab_alloc(&arena, sizes[k], lays[k][2].align);
+	default:
+		return ab_alloc_exact(&arena, sizes[k], lays[k][2].align);
+	}
+}
+
+static void *work(void *arg)
+{
+	const struct worker *w = arg;
+	size_t i;
+	for (i = w->first; i < w->first + w->count; ++i) {
+		size_t k = i % KINDS;
+		char *rec = place(w->m, k);
+		uint32_t *hdr;
+		char *name;
+		double *vals;
+		if (rec == NULL)
+			abort();
+
+		hdr = blnext(rec, 0, lays[k][0].align);
+		name = blnext(hdr, blsizeof(&lays[k][0]), lays[k][1].align);
+		vals = blnext(name, blsizeof(&lays[k][1]), lays[k][2].align);
+		*hdr = (uint32_t)i;
+		memset(name, 'a', blsizeof(&lays[k][1]));
+		vals[0] = (double)i;
+	}
+	return NULL;
+}
+
+static void run(const char *name, enum method m, unsigned nthreads)
+{
+	struct worker ws[MAX_THREADS];
+	unsigned t;
+	double secs;
+
+	ab_reset(&arena);
+	cursor = arena.base;
+	prev_size = 0;
+
+	secs = now();
+	for (t = 0; t < nthreads; ++t) {
+		ws[t].m = m;
+		ws[t].first = RECORDS / nthreads * t;
+		ws[t].count = RECORDS / nthreads;
+		if (pthread_create(&ws[t].tid, NULL, work, &ws[t]) != 0)
+			abort();
+	}
+	for (t = 0; t < nthreads; ++t)
+		pthread_join(ws[t].tid, NULL);
+	secs = now() - secs;
+
+	printf("  %-9s %7.1f Mrec/s  %5.1f%% padding\n", name,
+	       RECORDS / secs * 1e-6,
+	       100.0 * (double)((m == MUTEX ? (size_t)(cursor - arena.base)
+	                                      + prev_size
+	                                    : ab_used(&arena)) - payload)
+	       / (double)payload);
+}
+
+int main(void)
+{
+	static const size_t names[KINDS] = {5, 12, 27, 60};
+	static const size_t aligns[KINDS] = {8, 8, 8, 32};
+	unsigned nthreads;
+	size_t k;
+	void *block;
+
+	for (k = 0; k < KINDS; ++k) {
+		lays[k][0].nmemb = 1;
+		lays[k][0].size = sizeof(uint32_t);
+		lays[k][0].align = sizeof(uint32_t);
+		lays[k][1].nmemb = names[k];
+		lays[k][1].size = 1;
+		lays[k][1].align = 1;
+		lays[k][2].nmemb = 2;
+		lays[k][2].size = sizeof(double);
+		lays[k][2].align = aligns[k];
+		sizes[k] = blcalc(aligns[k], 0, 3, lays[k], 0);
+		payload += (RECORDS / KINDS)
+		           * (blsizeof(&lays[k][0]) + blsizeof(&lays[k][1])
+		              + blsizeof(&lays[k][2]));
+	}
+
+	block = aligned_alloc(64, CAP);
+	if (block == NULL)
+		return EXIT_FAILURE;
+
+	memset(block, 0, CAP);  /* Fault it in up front. */
+	ab_init(&arena, block, CAP);
+	for (nthreads = 1; nthreads <= MAX_THREADS; nthreads *= 2) {
+		printf("%u thread(s), %d records:\n", nthreads, RECORDS);
+		run("mutex", MUTEX, nthreads);
+		run("fetch-add", FETCH_ADD, nthreads);
+		run("cas", CAS, nthreads);
+	}
+	free(block);
+	return EXIT_SUCCESS;
+}
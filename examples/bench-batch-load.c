@@ -0,0 +1,175 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Writes 20000 small blocks, `{uint32_t id}, {float x k}, {uint16_t x m}`
+ * with `k` and `m` varying, one after the other into a file, and loads them
+ * all back, one `blio_readblk()` at a time and with `batch-load.h`, with and
+ * without `io_uring`. Each is timed with the file evicted from the page cache
+ * first (cold) and with it cached (warm).
+ *
+ * The file is created in the current directory, which should therefore not
+ * be on a `tmpfs`.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -pthread -I.. bench-batch-load.c -o bench-batch-load
+ */
+
+#define _DEFAULT_SOURCE
+#define BATCH_API static
+#define BATCH_IMPL
+#include "batch-load.h"  /* struct batch_loader, struct batch_req, batch_*() */
+/* BL_ALIGNMENT, struct blayout */
+#include "blayout.h"
+#include <fcntl.h>       /* open(), posix_fadvise() */
+#include <stdint.h>      /* uint16_t, uint32_t */
+#include <stdio.h>       /* printf(), perror() */
+#include <stdlib.h>      /* malloc(), calloc(), free(), EXIT_* */
+#include <string.h>      /* memset() */
+#include <time.h>        /* clock_gettime() */
+#include <unistd.h>      /* fsync(), unlink(), close() */
+
+#define NBLOCKS 20000
+#define PATH    "bench-batch-load.tmp"
+
+static struct blayout lays[NBLOCKS][3];
+static off_t offs[NBLOCKS];
+static void *regions[NBLOCKS][3];
+static struct batch_req reqs[NBLOCKS];
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void set(struct blayout *l, size_t nmemb, size_t size)
+{
+	l->nmemb = nmemb;
+	l->size = size;
+	l->align = size;
+}
+
+static int evict(int fd)
+{
+	return fsync(fd) != 0 ? -1 : posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+static void check(void *ctx, struct batch_req *r)
+{
+	size_t i = (size_t)(r - reqs);
+	if (r->err != 0 || *(uint32_t *)r->regions[0] != i)
+		++*(size_t *)ctx;
+}
+
+static double serial(int fd, size_t *bad)
+{
+	static void *blocks[NBLOCKS];
+	double t = now();
+	size_t i;
+	for (i = 0; i < NBLOCKS; ++i) {
+		blocks[i] = blio_readblk(fd, offs[i], BL_ALIGNMENT, 3, lays[i],
+		                         BLIO_SKIP_PADDING);
+		if (blocks[i] == NULL || *(uint32_t *)blocks[i] != i)
+			++*bad;
+	}
+	t = now() - t;
+	for (i = 0; i < NBLOCKS; ++i)
+		free(blocks[i]);
+	return t;
+}
+
+static double batched(int fd, int flags, size_t *bad)
+{
+	struct batch_loader l;
+	double t;
+	void *all;
+	size_t i;
+	batch_init(&l, 0, flags);
+	if (!(flags & BATCH_NO_URING) && l.ring == NULL) {
+		batch_destroy(&l);
+		return -1;
+	}
+
+	for (i = 0; i < NBLOCKS; ++i) {
+		reqs[i].fd = fd;
+		reqs[i].off = offs[i];
+		reqs[i].n = 3;
+		reqs[i].lays = lays[i];
+		reqs[i].regions = regions[i];
+	}
+	t = now();
+	all = batch_load(&l, reqs, NBLOCKS, BL_ALIGNMENT, BLIO_SKIP_PADDING,
+	                 check, bad);
+	t = now() - t;
+	if (all == NULL)
+		++*bad;
+
+	free(all);
+	batch_destroy(&l);
+	return t;
+}
+
+static void report(const char *name, double cold, double warm)
+{
+	if (cold < 0)
+		printf("  %-20s (unavailable)\n", name);
+	else
+		printf("  %-20s cold %8.2f ms, warm %7.2f ms\n", name, cold * 1e3,
+		       warm * 1e3);
+}
+
+int main(void)
+{
+	double cold[3], warm[3];
+	size_t bytes = 0, bad = 0, i;
+	int fd = open(PATH, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(PATH);
+		return EXIT_FAILURE;
+	}
+	unlink(PATH);
+
+	for (i = 0; i < NBLOCKS; ++i) {
+		char buf[4096];
+		ssize_t w;
+		set(&lays[i][0], 1, sizeof(uint32_t));
+		set(&lays[i][1], 16 + i % 241, sizeof(float));
+		set(&lays[i][2], 1 + i % 97, sizeof(uint16_t));
+		memset(buf, (int)i, sizeof buf);
+		*(uint32_t *)buf = (uint32_t)i;
+
+		/* `buf` stands in for a block; it's laid out the same way. */
+		offs[i] = (off_t)bytes;
+		w = blio_writeblk(fd, offs[i], buf, 3, lays[i], BLIO_SKIP_PADDING);
+		if (w < 0) {
+			perror("blio_writeblk");
+			return EXIT_FAILURE;
+		}
+		bytes += (size_t)w;
+	}
+	printf("%d blocks, %zu KiB:\n", NBLOCKS, bytes >> 10);
+
+	if (evict(fd) != 0)
+		return EXIT_FAILURE;
+	cold[0] = serial(fd, &bad);
+	warm[0] = serial(fd, &bad);
+	evict(fd);
+	cold[1] = batched(fd, BATCH_NO_URING, &bad);
+	warm[1] = batched(fd, BATCH_NO_URING, &bad);
+	evict(fd);
+	cold[2] = batched(fd, 0, &bad);
+	warm[2] = batched(fd, 0, &bad);
+	if (bad != 0) {
+		printf("%zu blocks came back wrong\n", bad);
+		return EXIT_FAILURE;
+	}
+
+	report("blio_readblk()", cold[0], warm[0]);
+	report("batch, threads", cold[1], warm[1]);
+	report("batch, io_uring", cold[2], warm[2]);
+	close(fd);
+	return EXIT_SUCCESS;
+}
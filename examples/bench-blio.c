@@ -0,0 +1,206 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Writes the regions of a laid-out block to a pipe and to a file, either by
+ * copying them into a staging buffer first and calling `write()`, or
+ * straight from the block with `blio.h`. Padding is skipped either way.
+ * Then reads the block back from the file, into a new block each time, with
+ * `blio_readblk()`.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -pthread -I.. bench-blio.c -o bench-blio
+ */
+
+#define _DEFAULT_SOURCE
+#define BLIO_API static
+#define BLIO_IMPL
+#include "blio.h"     /* blio_*() */
+/* BL_ALIGNMENT, struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <pthread.h>  /* pthread_create(), pthread_join() */
+#include <stddef.h>   /* size_t */
+#include <stdint.h>   /* uintptr_t */
+#include <stdio.h>    /* printf(), perror(), tmpfile(), fileno() */
+#include <stdlib.h>   /* malloc(), free(), EXIT_* */
+#include <string.h>   /* memcpy(), memcmp() */
+#include <time.h>     /* clock_gettime() */
+#include <unistd.h>   /* pipe(), read(), write(), pwrite(), close() */
+
+#define NREGIONS 16
+#define TOTAL    ((size_t)256 << 20)  /* Bytes moved per measurement. */
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void *drain(void *arg)
+{
+	static char buf[1 << 16];
+	int fd = *(int *)arg;
+	while (read(fd, buf, sizeof buf) > 0)
+		;
+	return NULL;
+}
+
+static int write_all(int fd, const char *p, size_t n, off_t off)
+{
+	while (n > 0) {
+		ssize_t r = off < 0 ? write(fd, p, n) : pwrite(fd, p, n, off);
+		if (r <= 0)
+			return -1;
+
+		p += r;
+		n -= (size_t)r;
+		if (off >= 0)
+			off += r;
+	}
+	return 0;
+}
+
+/* Copies every region into `stage`, back to back, then writes that. */
+static int staged(int fd, off_t off, char *block, char *stage,
+                  const struct blayout *lays)
+{
+	char *p = block;
+	size_t prev_size = 0;
+	size_t len = 0;
+	size_t i;
+	for (i = 0; i < NREGIONS; ++i) {
+		p = blnext(p, prev_size, lays[i].align);
+		prev_size = blsizeof(&lays[i]);
+		memcpy(stage + len, p, prev_size);
+		len += prev_size;
+	}
+	return write_all(fd, stage, len, off);
+}
+
+static int zero_copy(int fd, off_t off, char *block,
+                     const struct blayout *lays)
+{
+	struct iovec iov[NREGIONS];
+	size_t cnt = blio_iov(iov, block, NREGIONS, lays, BLIO_SKIP_PADDING);
+	return blio_writev(fd, iov, cnt, off) < 0 ? -1 : 0;
+}
+
+/* Whether the regions of `a` and `b` are equal; padding may differ. */
+static int same(const char *a, const char *b, const struct blayout *lays)
+{
+	size_t prev_size = 0;
+	size_t i;
+	for (i = 0; i < NREGIONS; ++i) {
+		a = blnext((void *)(uintptr_t)a, prev_size, lays[i].align);
+		b = blnext((void *)(uintptr_t)b, prev_size, lays[i].align);
+		prev_size = blsizeof(&lays[i]);
+		if (memcmp(a, b, prev_size) != 0)
+			return 0;
+	}
+	return 1;
+}
+
+static void read_back(int fd, const char *block, const struct blayout *lays,
+                      size_t payload)
+{
+	size_t iters = TOTAL / payload;
+	size_t i;
+	double t;
+	if (blio_writeblk(fd, 0, block, NREGIONS, lays, BLIO_SKIP_PADDING)
+	    != (ssize_t)payload) {
+		perror("blio_writeblk");
+		return;
+	}
+
+	t = now();
+	for (i = 0; i < iters; ++i) {
+		char *copy = blio_readblk(fd, 0, BL_ALIGNMENT, NREGIONS, lays,
+		                          BLIO_SKIP_PADDING);
+		if (copy == NULL) {
+			perror("blio_readblk");
+			return;
+		}
+		if (i == 0 && !same(block, copy, lays))
+			printf("  blio_readblk() read something else\n");
+		free(copy);
+	}
+	t = now() - t;
+	printf("  %-6s readblk    %8.1f MiB/s\n", "file",
+	       (double)(iters * payload) / t / (1 << 20));
+}
+
+static void run(const char *name, int fd, off_t off, char *block, char *stage,
+                const struct blayout *lays, size_t payload)
+{
+	size_t iters = TOTAL / payload;
+	size_t i;
+	double t;
+
+	t = now();
+	for (i = 0; i < iters; ++i)
+		if (staged(fd, off, block, stage, lays) != 0)
+			perror("write");
+	t = now() - t;
+	printf("  %-6s staged     %8.1f MiB/s\n", name,
+	       (double)(iters * payload) / t / (1 << 20));
+
+	t = now();
+	for (i = 0; i < iters; ++i)
+		if (zero_copy(fd, off, block, lays) != 0)
+			perror("writev");
+	t = now() - t;
+	printf("  %-6s zero-copy  %8.1f MiB/s\n", name,
+	       (double)(iters * payload) / t / (1 << 20));
+}
+
+int main(void)
+{
+	static const size_t scales[] = {16, 4096};
+	size_t s;
+	for (s = 0; s < sizeof scales / sizeof scales[0]; ++s) {
+		struct blayout lays[NREGIONS];
+		size_t payload = 0;
+		size_t size, i;
+		char *block, *stage;
+		pthread_t tid;
+		FILE *f;
+		int p[2];
+
+		/* Mixed element types, so there's padding to skip. */
+		for (i = 0; i < NREGIONS; ++i) {
+			static const size_t sizes[] = {1, 8, 2, 4};
+			lays[i].size = sizes[i % 4];
+			lays[i].align = sizes[i % 4];
+			lays[i].nmemb = scales[s] + i;
+			payload += blsizeof(&lays[i]);
+		}
+		size = blcalc(BL_ALIGNMENT, 0, NREGIONS, lays, 0);
+		block = malloc(size);
+		stage = malloc(payload);
+		f = tmpfile();
+		if (size == 0 || block == NULL || stage == NULL || f == NULL
+		    || pipe(p) != 0)
+			return EXIT_FAILURE;
+
+		for (i = 0; i < size; ++i)
+			block[i] = (char)i;
+		printf("%zu-byte block, %zu bytes of payload:\n", size, payload);
+
+		if (pthread_create(&tid, NULL, drain, &p[0]) != 0)
+			return EXIT_FAILURE;
+
+		run("pipe", p[1], -1, block, stage, lays, payload);
+		close(p[1]);
+		pthread_join(tid, NULL);
+		close(p[0]);
+
+		run("file", fileno(f), 0, block, stage, lays, payload);
+		read_back(fileno(f), block, lays, payload);
+		fclose(f);
+		free(stage);
+		free(block);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Runs an element-wise kernel and a sum over a block of three 16M-element
+ * regions, `{float x}`, `{float y}` and `{float d}`, on one thread and then
+ * with `par-for.h` on 1, 2, 4, ... threads, up to one per online CPU. Prints
+ * the time each takes and the speedup over one thread.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -pthread -I.. bench-par-for.c -o bench-par-for -lm
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#define PAR_API static
+#define PAR_IMPL
+#include "par-for.h"  /* struct par_pool, par_*() */
+/* struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <math.h>     /* sqrtf(), fabs() */
+#include <stdio.h>    /* printf(), perror() */
+#include <stdlib.h>   /* malloc(), free(), EXIT_* */
+#include <time.h>     /* clock_gettime() */
+#include <unistd.h>   /* sysconf() */
+
+#define N      ((size_t)1 << 24)
+#define ROUNDS 5
+
+static const struct blayout lays[3] = {
+	{N, sizeof(float), sizeof(float)},
+	{N, sizeof(float), sizeof(float)},
+	{N, sizeof(float), sizeof(float)}
+};
+
+static float *regs[3];
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* `d = sqrt(x * x + y * y)`, driven by region `d`. */
+static void norm(void *ctx, size_t region, void *ptr, size_t first,
+                 size_t count)
+{
+	const float *x = regs[0], *y = regs[1];
+	float *d = (float *)ptr;
+	size_t i;
+	(void)ctx;
+	if (region != 2)
+		return;
+
+	for (i = first; i < first + count; ++i)
+		d[i] = sqrtf(x[i] * x[i] + y[i] * y[i]);
+}
+
+static void norm_one(void *ctx, size_t region, void *elem, size_t i)
+{
+	(void)ctx;
+	if (region == 2)
+		*(float *)elem = sqrtf(regs[0][i] * regs[0][i]
+		                       + regs[1][i] * regs[1][i]);
+}
+
+static void sum(void *ctx, void *acc, size_t region, void *ptr, size_t first,
+                size_t count)
+{
+	const float *d = (const float *)ptr;
+	double s = 0;
+	size_t i;
+	(void)ctx;
+	if (region != 2)
+		return;
+
+	for (i = first; i < first + count; ++i)
+		s += d[i];
+	*(double *)acc += s;
+}
+
+static void add(void *ctx, void *acc, const void *other)
+{
+	(void)ctx;
+	*(double *)acc += *(const double *)other;
+}
+
+/* Best of `ROUNDS`. */
+static double best(double *t)
+{
+	double b = t[0];
+	int r;
+	for (r = 1; r < ROUNDS; ++r)
+		b = t[r] < b ? t[r] : b;
+	return b;
+}
+
+int main(void)
+{
+	double t_norm[ROUNDS], t_one[ROUNDS], t_sum[ROUNDS];
+	double base_norm, base_sum, total = 0, expect;
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t size = blcalc(BL_ALIGNMENT, 0, 3, lays, 0);
+	char *block;
+	unsigned n;
+	size_t i;
+	int r;
+	if (size == 0 || (block = malloc(size)) == NULL)
+		return EXIT_FAILURE;
+
+	regs[0] = blnext(block, 0, lays[0].align);
+	regs[1] = blnext(regs[0], blsizeof(&lays[0]), lays[1].align);
+	regs[2] = blnext(regs[1], blsizeof(&lays[1]), lays[2].align);
+	for (i = 0; i < N; ++i) {
+		regs[0][i] = (float)(i % 1000);
+		regs[1][i] = (float)(i % 777);
+		regs[2][i] = 0;
+	}
+
+	for (r = 0; r < ROUNDS; ++r) {
+		double t = now();
+		norm(NULL, 2, regs[2], 0, N);
+		t_norm[r] = now() - t;
+		t = now();
+		expect = 0;
+		sum(NULL, &expect, 2, regs[2], 0, N);
+		t_sum[r] = now() - t;
+	}
+	base_norm = best(t_norm);
+	base_sum = best(t_sum);
+	printf("%zu MiB block, serial: norm %.2f ms, sum %.2f ms\n", size >> 20,
+	       base_norm * 1e3, base_sum * 1e3);
+
+	for (n = 1; n <= (ncpu > 0 ? (unsigned)ncpu : 1); n *= 2) {
+		struct par_pool pool;
+		if (par_pool_init(&pool, n) != 0) {
+			perror("par_pool_init");
+			return EXIT_FAILURE;
+		}
+
+		for (r = 0; r < ROUNDS; ++r) {
+			double t = now();
+			if (par_for_range(&pool, block, 3, lays, norm, NULL) != 0)
+				return EXIT_FAILURE;
+			t_norm[r] = now() - t;
+
+			t = now();
+			if (par_for_each(&pool, block, 3, lays, norm_one, NULL) != 0)
+				return EXIT_FAILURE;
+			t_one[r] = now() - t;
+
+			t = now();
+			total = 0;
+			if (par_reduce(&pool, block, 3, lays, sum, add, NULL, &total,
+			               sizeof total) != 0)
+				return EXIT_FAILURE;
+			t_sum[r] = now() - t;
+		}
+		par_pool_destroy(&pool);
+
+		/* Summed in a different order. */
+		if (fabs(total - expect) > 1e-9 * expect)
+			return EXIT_FAILURE;
+
+		printf("  %2u thread(s): range %7.2f ms (%5.2fx), "
+		       "each %7.2f ms, sum %7.2f ms (%5.2fx)\n", n,
+		       best(t_norm) * 1e3, base_norm / best(t_norm),
+		       best(t_one) * 1e3, best(t_sum) * 1e3,
+		       base_sum / best(t_sum));
+	}
+
+	free(block);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Reads one region out of each of many separately allocated blocks, visited
+ * in random order through an array of pointers (so every block is a likely
+ * cache miss), with and without `prefetch.h`.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -I.. bench-prefetch.c -o bench-prefetch
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include "prefetch.h"  /* pr_plan(), pr_ahead(), pr_gather() */
+/* BL_ALIGNMENT, struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <stdalign.h>  /* alignof */
+#include <stddef.h>    /* size_t */
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* printf(), fprintf() */
+#include <stdlib.h>    /* malloc(), free(), EXIT_* */
+#include <time.h>      /* clock_gettime() */
+
+#define lengthof(A) (sizeof (A) / sizeof (A)[0])
+
+#define NBLOCKS (1u << 20)
+#define K       3  /* The region we read. */
+
+static const struct blayout lays[] = {
+	{1,  24,             8               },
+	{16, sizeof(int),    alignof(int)    },
+	{4,  sizeof(double), alignof(double) },
+	{8,  sizeof(float),  alignof(float)  }
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static float sum8(const float *f)
+{
+	return f[0] + f[1] + f[2] + f[3] + f[4] + f[5] + f[6] + f[7];
+}
+
+/* Walk the `blnext()` chain to region `K` of every block. */
+static float by_chain(void *const *blocks, size_t n)
+{
+	float s = 0;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		void *p = blnext(blocks[i], 0, lays[0].align);
+		size_t k;
+		for (k = 1; k <= K; ++k)
+			p = blnext(p, blsizeof(&lays[k - 1]), lays[k].align);
+		s += sum8(p);
+	}
+	return s;
+}
+
+static float by_plan(void *const *blocks, size_t n, size_t off)
+{
+	float s = 0;
+	size_t i;
+	for (i = 0; i < n; ++i)
+		s += sum8((const float *)((const char *)blocks[i] + off));
+	return s;
+}
+
+static float by_prefetch(void *const *blocks, size_t n, size_t off,
+                         size_t dist)
+{
+	const void *const *b = (const void *const *)blocks;
+	float s = 0;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		pr_ahead(b, n, i + dist, off, 8 * sizeof(float));
+		s += sum8((const float *)((const char *)blocks[i] + off));
+	}
+	return s;
+}
+
+static float by_gather(void *const *blocks, size_t n, size_t off, float *tmp)
+{
+	float s = 0;
+	size_t i;
+	pr_gather(tmp, (const void *const *)blocks, n, off, 8 * sizeof(float), 0);
+	for (i = 0; i < n; ++i)
+		s += sum8(tmp + 8 * i);
+	return s;
+}
+
+int main(void)
+{
+	size_t offs[lengthof(lays)];
+	size_t size = blcalc(BL_ALIGNMENT, 0, lengthof(lays), lays, 0);
+	void **blocks = malloc(NBLOCKS * sizeof *blocks);
+	float *tmp = malloc(NBLOCKS * 8 * sizeof *tmp);
+	uint64_t seed = 0x9e3779b97f4a7c15u;
+	float sink = 0;
+	size_t i;
+	if (size == 0 || blocks == NULL || tmp == NULL
+	    || pr_plan(offs, BL_ALIGNMENT, lengthof(lays), lays) != 0)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < NBLOCKS; ++i) {
+		float *f;
+		size_t j;
+		blocks[i] = malloc(size);
+		if (blocks[i] == NULL)
+			return EXIT_FAILURE;
+
+		f = (float *)((char *)blocks[i] + offs[K]);
+		for (j = 0; j < 8; ++j)
+			f[j] = (float)j;
+	}
+
+	/* Shuffle, so that hardware prefetchers can't help. */
+	for (i = NBLOCKS - 1; i > 0; --i) {
+		size_t j;
+		void *t;
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		j = (size_t)(seed % (i + 1));
+		t = blocks[i];
+		blocks[i] = blocks[j];
+		blocks[j] = t;
+	}
+
+	{
+		static const size_t dists[] = {4, 8, 16, 32};
+		double t = now();
+		sink += by_chain(blocks, NBLOCKS);
+		printf("%-22s %6.2f ns/block\n", "blnext() chain",
+		       (now() - t) * 1e9 / NBLOCKS);
+
+		t = now();
+		sink += by_plan(blocks, NBLOCKS, offs[K]);
+		printf("%-22s %6.2f ns/block\n", "plan",
+		       (now() - t) * 1e9 / NBLOCKS);
+
+		for (i = 0; i < lengthof(dists); ++i) {
+			char name[32];
+			t = now();
+			sink += by_prefetch(blocks, NBLOCKS, offs[K], dists[i]);
+			snprintf(name, sizeof name, "plan + prefetch(%zu)", dists[i]);
+			printf("%-22s %6.2f ns/block\n", name,
+			       (now() - t) * 1e9 / NBLOCKS);
+		}
+
+		t = now();
+		sink += by_gather(blocks, NBLOCKS, offs[K], tmp);
+		printf("%-22s %6.2f ns/block\n", "pr_gather()",
+		       (now() - t) * 1e9 / NBLOCKS);
+	}
+
+	for (i = 0; i < NBLOCKS; ++i)
+		free(blocks[i]);
+	free(tmp);
+	free(blocks);
+	fprintf(stderr, "(sink: %f)\n", (double)sink);
+	return EXIT_SUCCESS;
+}
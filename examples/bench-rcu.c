@@ -0,0 +1,236 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * 1 to 64 reader threads look entries up in a table that a writer thread
+ * replaces wholesale every millisecond, with the table behind a `pthread`
+ * rwlock or published with `rcu.h`. With `rcu.h`, tables come either from
+ * `rcu_alloc()` or from `aligned_malloc()`, retired with `rcu_retire_fn()`.
+ * Prints lookups per second.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -pthread -I.. bench-rcu.c -o bench-rcu
+ */
+
+#define _GNU_SOURCE  /* pthread_rwlockattr_setkind_np() */
+#define RCU_API static
+#define RCU_IMPL
+#include "rcu.h"       /* struct rcu_domain, struct rcu_reader, rcu_*() */
+#define AM_API static
+#define AM_IMPL
+#include "aligned-malloc.h"  /* aligned_malloc(), aligned_free() */
+/* struct blayout, blcalc(), blaligned(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <pthread.h>   /* pthread_*() */
+#include <stdint.h>    /* uint32_t, uint64_t */
+#include <stdio.h>     /* printf() */
+#include <stdlib.h>    /* malloc(), free(), abort(), EXIT_* */
+#include <time.h>      /* clock_gettime(), nanosleep() */
+
+#define MAX_READERS 64
+#define ENTRIES     4096
+#define SECONDS     0.25
+#define QUIESCE     64  /* Lookups between quiescent states. */
+#define LINE        64
+
+enum method {
+	RWLOCK,
+	RCU,
+	RCU_FN  /* Tables from `aligned_malloc()`. */
+};
+
+/* A table is {uint32_t version}, {uint64_t keys x ENTRIES}. */
+static const struct blayout lays[2] = {
+	{1, sizeof(uint32_t), sizeof(uint32_t)},
+	{ENTRIES, sizeof(uint64_t), sizeof(uint64_t)}
+};
+
+static void *table;
+static pthread_rwlock_t rwlock;
+static struct rcu_domain dom;
+static int stop;  /* Accessed atomically. */
+
+struct worker {
+	pthread_t tid;
+	enum method m;
+	unsigned long long lookups;
+	uint64_t sum;  /* So that the lookups aren't optimized away. */
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t *keys(void *t)
+{
+	return blnext(t, blsizeof(&lays[0]), lays[1].align);
+}
+
+static void *make(enum method m, uint32_t version)
+{
+	void *t;
+	uint64_t *k;
+	size_t i;
+	switch (m) {
+	case RWLOCK:
+		t = malloc(blcalc(BL_ALIGNMENT, 0, 2, lays, 0));
+		break;
+	case RCU:
+		t = rcu_alloc(2, lays);
+		break;
+	case RCU_FN:
+		t = aligned_malloc(LINE, blaligned(blcalc(LINE, 0, 2, lays, 0), LINE));
+		break;
+	}
+	if (t == NULL)
+		abort();
+
+	*(uint32_t *)t = version;
+	k = keys(t);
+	for (i = 0; i < ENTRIES; ++i)
+		k[i] = (uint64_t)i * version;
+	return t;
+}
+
+/* Frees a table that was never published. */
+static void discard(enum method m, void *t)
+{
+	switch (m) {
+	case RWLOCK:
+		free(t);
+		break;
+	case RCU:
+		rcu_discard(t);
+		break;
+	case RCU_FN:
+		aligned_free(t);
+		break;
+	}
+}
+
+static uint64_t lookup(void *t, uint64_t x)
+{
+	return keys(t)[(x * 0x9e3779b97f4a7c15u) >> 52];
+}
+
+static void *read_loop(void *arg)
+{
+	struct worker *w = arg;
+	struct rcu_reader r;
+	uint64_t x = 0, sum = 0;
+	if (w->m != RWLOCK && rcu_register(&dom, &r) != 0)
+		abort();
+
+	while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+		int i;
+		for (i = 0; i < QUIESCE; ++i, ++x) {
+			if (w->m != RWLOCK) {
+				sum += lookup(rcu_read(&table), x);
+			} else {
+				pthread_rwlock_rdlock(&rwlock);
+				sum += lookup(table, x);
+				pthread_rwlock_unlock(&rwlock);
+			}
+		}
+		if (w->m != RWLOCK)
+			rcu_quiescent(&dom, &r);
+	}
+
+	if (w->m != RWLOCK)
+		rcu_unregister(&dom, &r);
+	w->lookups = x;
+	w->sum = sum;
+	return NULL;
+}
+
+static void run(const char *name, enum method m, unsigned nreaders)
+{
+	static struct worker ws[MAX_READERS];
+	const struct timespec ms = {0, 1000000};
+	unsigned long long total = 0;
+	uint32_t version = 1;
+	double t;
+	unsigned i;
+
+	table = make(m, version);
+	__atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+	for (i = 0; i < nreaders; ++i) {
+		ws[i].m = m;
+		if (pthread_create(&ws[i].tid, NULL, read_loop, &ws[i]) != 0)
+			abort();
+	}
+
+	/* This thread is the writer. */
+	t = now();
+	for (;;) {
+		void *next = make(m, version + 1);
+		if (now() - t >= SECONDS) {
+			discard(m, next);
+			break;
+		}
+
+		++version;
+		if (m == RCU) {
+			rcu_retire(&dom, rcu_publish(&table, next));
+		} else if (m == RCU_FN) {
+			rcu_retire_fn(&dom, rcu_publish(&table, next), aligned_free);
+		} else {
+			void *old;
+			pthread_rwlock_wrlock(&rwlock);
+			old = table;
+			table = next;
+			pthread_rwlock_unlock(&rwlock);
+			free(old);
+		}
+		nanosleep(&ms, NULL);
+	}
+	__atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+	for (i = 0; i < nreaders; ++i) {
+		pthread_join(ws[i].tid, NULL);
+		total += ws[i].lookups;
+	}
+	t = now() - t;
+
+	if (m == RCU) {
+		rcu_retire(&dom, rcu_publish(&table, NULL));
+		rcu_reclaim(&dom);
+	} else if (m == RCU_FN) {
+		rcu_retire_fn(&dom, rcu_publish(&table, NULL), aligned_free);
+		rcu_reclaim(&dom);
+	} else {
+		free(table);
+	}
+	printf("  %-7s %8.1f Mlookups/s  (%u tables)\n", name,
+	       (double)total / t * 1e-6, version);
+}
+
+int main(void)
+{
+	pthread_rwlockattr_t attr;
+	unsigned n;
+	if (rcu_init(&dom) != 0 || pthread_rwlockattr_init(&attr) != 0)
+		return EXIT_FAILURE;
+
+#ifdef __GLIBC__
+	/* glibc prefers readers by default, which starves the writer here. */
+	pthread_rwlockattr_setkind_np(&attr,
+	                              PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+	if (pthread_rwlock_init(&rwlock, &attr) != 0)
+		return EXIT_FAILURE;
+
+	for (n = 1; n <= MAX_READERS; n *= 2) {
+		printf("%u reader(s):\n", n);
+		run("rwlock", RWLOCK, n);
+		run("rcu", RCU, n);
+		run("rcu+fn", RCU_FN, n);
+	}
+	pthread_rwlock_destroy(&rwlock);
+	pthread_rwlockattr_destroy(&attr);
+	rcu_destroy(&dom);
+	return EXIT_SUCCESS;
+}
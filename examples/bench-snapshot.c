@@ -0,0 +1,137 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Snapshots a 512 MiB block with a full `memcpy()` and with `snapshot.h`,
+ * while a writer updates 1% of its pages in between. Prints how long each
+ * snapshot takes and what the writes cost afterwards, since with
+ * `snapshot.h` the first write to each page copies it. Then takes each
+ * snapshot while holding on to the one before, as a reader that's still busy
+ * with it would.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -I.. bench-snapshot.c -o bench-snapshot
+ */
+
+#define _GNU_SOURCE
+#define SNAP_API static
+#define SNAP_IMPL
+#include "snapshot.h"  /* struct snap_block, struct snap, snap_*() */
+/* struct blayout, blnext(), blsizeof() */
+#include "blayout.h"
+#include <stdint.h>    /* uint64_t */
+#include <stdio.h>     /* printf(), perror() */
+#include <stdlib.h>    /* malloc(), free(), EXIT_* */
+#include <string.h>    /* memcpy(), memset() */
+#include <time.h>      /* clock_gettime() */
+
+#define SIZE   ((size_t)512 << 20)
+#define ROUNDS 5
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Bumps one counter in every 100th page. */
+static double write_some(uint64_t *vals, size_t n, size_t page, int round)
+{
+	const size_t stride = page / sizeof *vals * 100;
+	double t = now();
+	size_t i;
+	for (i = (size_t)round; i < n; i += stride)
+		++vals[i];
+	return now() - t;
+}
+
+int main(void)
+{
+	const struct blayout lays[] = {{64, 1, 1},
+	                               {SIZE / sizeof(uint64_t) - 64,
+	                                sizeof(uint64_t), sizeof(uint64_t)}};
+	const size_t n = lays[1].nmemb;
+	struct snap_block b;
+	struct snap s, older;
+	uint64_t *vals;
+	char *copy;
+	double t, w;
+	int r;
+
+	if (snap_init(&b, 2, lays) != 0) {
+		perror("snap_init");
+		return EXIT_FAILURE;
+	}
+	vals = blnext(blnext(b.base, 0, lays[0].align), blsizeof(&lays[0]),
+	              lays[1].align);
+	memset(b.base, 1, b.size);
+
+	copy = malloc(b.size);
+	if (copy == NULL)
+		return EXIT_FAILURE;
+
+	memset(copy, 0, b.size);  /* Fault it in up front. */
+	printf("%zu MiB block, %zu-byte pages:\n", b.size >> 20, b.page);
+
+	for (r = 0; r < ROUNDS; ++r) {
+		t = now();
+		memcpy(copy, b.base, b.size);
+		t = now() - t;
+		w = write_some(vals, n, b.page, r);
+		printf("  memcpy     %9.3f ms, then writes %7.3f ms\n",
+		       t * 1e3, w * 1e3);
+	}
+
+	for (r = 0; r < ROUNDS; ++r) {
+		const uint64_t *old;
+		uint64_t before = vals[r];
+		t = now();
+		if (snap_take(&b, &s) != 0) {
+			perror("snap_take");
+			return EXIT_FAILURE;
+		}
+		t = now() - t;
+		w = write_some(vals, n, b.page, r);
+		old = snap_at(&b, &s, vals);
+		if (old[r] != before || vals[r] != before + 1)
+			return EXIT_FAILURE;
+
+		printf("  snap_take  %9.3f ms, then writes %7.3f ms\n",
+		       t * 1e3, w * 1e3);
+		snap_release(&s);
+	}
+
+	/*
+	 * With an older snapshot still around, only the pages written since the
+	 * file was last brought up to date are copied, but they add up.
+	 */
+	if (snap_take(&b, &older) != 0)
+		return EXIT_FAILURE;
+
+	for (r = 0; r < ROUNDS; ++r) {
+		const uint64_t *old, *prev = snap_at(&b, &older, vals);
+		uint64_t before = vals[r];
+		write_some(vals, n, b.page, r);
+		t = now();
+		if (snap_take(&b, &s) != 0) {
+			perror("snap_take");
+			return EXIT_FAILURE;
+		}
+		t = now() - t;
+		old = snap_at(&b, &s, vals);
+		if (prev[r] != before || old[r] != before + 1)
+			return EXIT_FAILURE;
+
+		printf("  snap_take  %9.3f ms, with an older snapshot alive\n",
+		       t * 1e3);
+		snap_release(&older);
+		older = s;
+	}
+	snap_release(&older);
+
+	free(copy);
+	snap_destroy(&b);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Compares lookups in `swiss-map.h`'s single-block table against the very
+ * same table whose control bytes, keys and values were copied into three
+ * separate allocations. Also reports the memory footprint of both, and
+ * then churns the single-block table, erasing a random key and inserting a
+ * new one over and over. It reports what that churn costs, and what the
+ * tombstones it leaves behind do to lookups.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -msse2 -I.. bench-swiss-map.c -o bench-swiss-map
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define SM_API static
+#define SM_IMPL
+#include "swiss-map.h"  /* struct sm_map, sm_*() */
+#include <stddef.h>     /* size_t, NULL */
+#include <stdint.h>     /* uint64_t */
+#include <stdio.h>      /* printf(), fprintf() */
+#include <stdlib.h>     /* malloc(), free(), aligned_alloc(), EXIT_* */
+#include <string.h>     /* memcpy() */
+#include <time.h>       /* clock_gettime() */
+#ifdef __GLIBC__
+#include <malloc.h>     /* malloc_usable_size() */
+#define usable(p) malloc_usable_size(p)
+#else
+#define usable(p) ((size_t)0)
+#endif
+
+#define LOOKUPS 4000000
+#define CHURN   1000000  /* Erase-insert pairs. */
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift(uint64_t *s)
+{
+	*s ^= *s << 13;
+	*s ^= *s >> 7;
+	*s ^= *s << 17;
+	return *s;
+}
+
+/* Half hits, half misses, in random order. */
+static double bench(const struct sm_map *m, const uint64_t *keys, size_t n,
+                    uint64_t *sink)
+{
+	uint64_t s = 88172645463325252u;
+	uint64_t acc = 0;
+	double t = now();
+	size_t i;
+	for (i = 0; i < LOOKUPS; ++i) {
+		uint64_t r = xorshift(&s);
+		uint64_t k = (r & 1) ? keys[r % n] : r | 1;
+		uint64_t *v = sm_find(m, k);
+		acc += v != NULL ? *v : 1;
+	}
+	t = now() - t;
+	*sink += acc;
+	return t * 1e9 / LOOKUPS;
+}
+
+/* Replaces `CHURN` random keys with new ones, erasing, then inserting. */
+static double churn(struct sm_map *m, uint64_t *keys, size_t n)
+{
+	uint64_t s = 1181783497276652981u;
+	double t = now();
+	size_t i;
+	for (i = 0; i < CHURN; ++i) {
+		size_t j = (size_t)(xorshift(&s) % n);
+		sm_erase(m, keys[j]);
+		keys[j] = xorshift(&s) & ~(uint64_t)1;
+		if (sm_insert(m, keys[j], j) == NULL)
+			return -1;
+	}
+	t = now() - t;
+	return t * 1e9 / CHURN;
+}
+
+int main(void)
+{
+	static const size_t sizes[] = {1000, 16000, 250000, 4000000};
+	uint64_t sink = 0;
+	size_t i;
+	printf("%10s %12s %12s %12s %12s %12s %12s\n",
+	       "entries", "single ns", "separate ns", "single B", "separate B",
+	       "churn ns", "churned ns");
+	for (i = 0; i < sizeof sizes / sizeof sizes[0]; ++i) {
+		size_t n = sizes[i];
+		size_t cap;
+		size_t j;
+		uint64_t s = 2463534242u;
+		struct sm_map m = SM_INIT;
+		struct sm_map sep;
+		uint64_t *keys = malloc(n * sizeof *keys);
+		if (keys == NULL || sm_reserve(&m, n) != 0)
+			return EXIT_FAILURE;
+
+		for (j = 0; j < n; ++j) {
+			keys[j] = xorshift(&s) & ~(uint64_t)1;  /* Misses are odd. */
+			if (sm_insert(&m, keys[j], j) == NULL)
+				return EXIT_FAILURE;
+		}
+
+		/* Same contents, three allocations. */
+		cap = m.mask + 1;
+		sep = m;
+		sep.ctrl = aligned_alloc(SM_GROUP, cap);
+		sep.keys = malloc(cap * sizeof *sep.keys);
+		sep.vals = malloc(cap * sizeof *sep.vals);
+		if (sep.ctrl == NULL || sep.keys == NULL || sep.vals == NULL)
+			return EXIT_FAILURE;
+
+		memcpy(sep.ctrl, m.ctrl, cap);
+		memcpy(sep.keys, m.keys, cap * sizeof *sep.keys);
+		memcpy(sep.vals, m.vals, cap * sizeof *sep.vals);
+
+		{
+			double t1 = bench(&m, keys, n, &sink);
+			double t2 = bench(&sep, keys, n, &sink);
+			size_t b1 = usable(m.blk) ? usable(m.blk) : sm_footprint(&m);
+			size_t b2 = usable(sep.ctrl) + usable(sep.keys) + usable(sep.vals);
+			double t3 = churn(&m, keys, n);
+			double t4 = bench(&m, keys, n, &sink);
+			if (t3 < 0)
+				return EXIT_FAILURE;
+			if (b2 == 0)
+				b2 = cap + cap * (sizeof *sep.keys + sizeof *sep.vals);
+			printf("%10zu %12.2f %12.2f %12zu %12zu %12.2f %12.2f\n", n, t1,
+			       t2, b1, b2, t3, t4);
+		}
+
+		free(sep.vals);
+		free(sep.keys);
+		free(sep.ctrl);
+		sm_free(&m);
+		free(keys);
+	}
+
+	fprintf(stderr, "(sink: %llu)\n", (unsigned long long)sink);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Converts a million rows of `struct row` to the regions of a laid-out block
+ * and back, with a scalar loop per field and with `transpose.h`, and compares
+ * both with a plain `memcpy()` of the same amount of data.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -march=native -I.. bench-transpose.c -o bench-transpose
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define TP_API static
+#define TP_IMPL
+#include "transpose.h"  /* struct tp_field, tp_*() */
+/* BL_ALIGNMENT, struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <stddef.h>     /* size_t, offsetof() */
+#include <stdint.h>     /* uint64_t */
+#include <stdio.h>      /* printf() */
+#include <stdlib.h>     /* malloc(), free(), EXIT_* */
+#include <string.h>     /* memcpy(), memset() */
+#include <time.h>       /* clock_gettime() */
+
+#define ROWS    ((size_t)1 << 20)
+#define REPEAT  20
+#define NFIELDS 8
+
+struct row {
+	float x, y, z, w;
+	double t0, t1;
+	uint64_t id;
+	int flags;
+};
+
+static const struct tp_field fields[NFIELDS] = {
+	{offsetof(struct row, x), 4},
+	{offsetof(struct row, y), 4},
+	{offsetof(struct row, z), 4},
+	{offsetof(struct row, w), 4},
+	{offsetof(struct row, t0), 8},
+	{offsetof(struct row, t1), 8},
+	{offsetof(struct row, id), 8},
+	{offsetof(struct row, flags), 4},
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* What `tp_aos_to_soa()` replaces: one pass over the rows per field. */
+static void scalar_in(char *block, const struct blayout *lays,
+                      const struct row *rows)
+{
+	char *region = block;
+	size_t prev_size = 0;
+	size_t f, i;
+	for (f = 0; f < NFIELDS; ++f) {
+		region = blnext(region, prev_size, lays[f].align);
+		prev_size = blsizeof(&lays[f]);
+		for (i = 0; i < ROWS; ++i)
+			memcpy(region + i * fields[f].size,
+			       (const char *)&rows[i] + fields[f].offset,
+			       fields[f].size);
+	}
+}
+
+static void scalar_out(struct row *rows, char *block,
+                       const struct blayout *lays)
+{
+	char *region = block;
+	size_t prev_size = 0;
+	size_t f, i;
+	for (f = 0; f < NFIELDS; ++f) {
+		region = blnext(region, prev_size, lays[f].align);
+		prev_size = blsizeof(&lays[f]);
+		for (i = 0; i < ROWS; ++i)
+			memcpy((char *)&rows[i] + fields[f].offset,
+			       region + i * fields[f].size, fields[f].size);
+	}
+}
+
+static void report(const char *name, double t, size_t bytes)
+{
+	printf("  %-12s %8.2f ms  %8.1f MiB/s\n", name, t / REPEAT * 1e3,
+	       (double)bytes * REPEAT / t / (1 << 20));
+}
+
+int main(void)
+{
+	struct blayout lays[NFIELDS];
+	size_t payload = 0;
+	size_t size, i;
+	struct row *rows, *back;
+	char *block;
+	double t;
+	int r;
+
+	for (i = 0; i < NFIELDS; ++i) {
+		lays[i].nmemb = ROWS;
+		lays[i].size = fields[i].size;
+		lays[i].align = fields[i].size;
+		payload += fields[i].size * ROWS;
+	}
+	size = blcalc(BL_ALIGNMENT, 0, NFIELDS, lays, 0);
+	rows = malloc(ROWS * sizeof *rows);
+	back = malloc(ROWS * sizeof *back);
+	block = malloc(size);
+	if (size == 0 || rows == NULL || back == NULL || block == NULL)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < ROWS; ++i) {
+		rows[i].x = (float)i;
+		rows[i].y = (float)i + 0.25f;
+		rows[i].z = (float)i + 0.5f;
+		rows[i].w = (float)i + 0.75f;
+		rows[i].t0 = (double)i * 2;
+		rows[i].t1 = (double)i * 3;
+		rows[i].id = (uint64_t)i * 0x9e3779b97f4a7c15u;
+		rows[i].flags = (int)i;
+	}
+	memset(block, 0, size);
+	memset(back, 0, ROWS * sizeof *back);
+	printf("%zu rows, %zu bytes of payload:\n", ROWS, payload);
+
+	t = now();
+	for (r = 0; r < REPEAT; ++r)
+		memcpy(block, rows, payload);
+	report("memcpy", now() - t, payload);
+
+	t = now();
+	for (r = 0; r < REPEAT; ++r)
+		scalar_in(block, lays, rows);
+	report("scalar in", now() - t, payload);
+
+	t = now();
+	for (r = 0; r < REPEAT; ++r)
+		tp_aos_to_soa(block, lays, rows, sizeof *rows, ROWS, NFIELDS,
+		              fields);
+	report("tp in", now() - t, payload);
+
+	t = now();
+	for (r = 0; r < REPEAT; ++r)
+		scalar_out(back, block, lays);
+	report("scalar out", now() - t, payload);
+
+	t = now();
+	for (r = 0; r < REPEAT; ++r)
+		tp_soa_to_aos(back, sizeof *back, ROWS, block, lays, NFIELDS,
+		              fields);
+	report("tp out", now() - t, payload);
+
+	for (i = 0; i < ROWS; ++i)
+		if (memcmp(&rows[i], &back[i], offsetof(struct row, flags)
+		                                 + sizeof rows[i].flags) != 0)
+			return EXIT_FAILURE;
+
+	free(block);
+	free(back);
+	free(rows);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Bit-packed regions: arrays of flags or small enums, 1, 2, 4 or 8 bits per
+ * element, packed into 64-bit words so a layout doesn't have to spend a whole
+ * byte (or more) on each.
+ *
+ * A bit-packed region is an ordinary region of `uint64_t`s as far as
+ * `blcalc()` and `blnext()` are concerned; `BR_LAYOUT()` and `br_layout()`
+ * size it. Elements never straddle words. Element `i` occupies bits
+ * `[i % per * width, (i % per + 1) * width)` of word `i / per`, where
+ * `per = 64 / width`.
+ *
+ * Bulk operations look at whole words: each field of a word is compared to
+ * the value being looked for with a few SWAR operations, 2 or 4 words at a
+ * time with SSE2 or AVX2. Fields past the `n`th element are ignored.
+ *
+ * Everything is `static inline`. Example usage:
+ * ```c
+ * #include "bit-regions.h"  // BR_LAYOUT(), br_*()
+ *
+ * const struct blayout lays[] = {
+ *     {n, sizeof(double), alignof(double)},
+ *     BR_LAYOUT(n, 1),  // One flag per `double`.
+ *     BR_LAYOUT(n, 2)   // One 2-bit enum per `double`.
+ * };
+ * // ... `blcalc()`, `malloc()`, then:
+ * uint64_t *flags = blnext(d, blsizeof(&lays[0]), lays[1].align);
+ * br_set(flags, 1, 42, 1);
+ * size_t set = br_count(flags, 1, n, 1);
+ * size_t first = br_find(flags, 1, n, 1, 0);  // 42
+ * ```
+ */
+
+#ifndef BR_H
+#define BR_H
+
+#include "blayout.h"  /* struct blayout */
+#include <stddef.h>   /* size_t */
+#include <stdint.h>   /* uint64_t, UINT64_C() */
+#include <string.h>   /* memset() */
+
+#if defined __AVX2__
+#	include <immintrin.h>  /* __m256i, _mm256_*() */
+#elif defined __SSE2__ || defined _M_X64
+#	include <emmintrin.h>  /* __m128i, _mm_*() */
+#endif
+
+#define BR_WORD_BITS 64
+
+/*
+ * A `struct blayout` initializer for `nmemb` elements of `width` bits.
+ * `alignof(uint64_t)` may be smaller, but being stricter is harmless.
+ */
+#define BR_LAYOUT(nmemb, width)                                   \
+	{(nmemb) / (BR_WORD_BITS / (width))                           \
+	     + ((nmemb) % (BR_WORD_BITS / (width)) != 0),             \
+	 sizeof(uint64_t), sizeof(uint64_t)}
+
+/* Number of words needed for `nmemb` elements of `width` bits. */
+static inline size_t br_words(size_t nmemb, unsigned width)
+{
+	size_t per = BR_WORD_BITS / width;
+	return nmemb / per + (nmemb % per != 0);
+}
+
+/* Same as `BR_LAYOUT()`. `width` must be 1, 2, 4 or 8. */
+static inline struct blayout br_layout(size_t nmemb, unsigned width)
+{
+	struct blayout l;
+	l.nmemb = br_words(nmemb, width);
+	l.size = sizeof(uint64_t);
+	l.align = sizeof(uint64_t);
+	return l;
+}
+
+static inline uint64_t br_mask(unsigned width)
+{
+	return (UINT64_C(1) << width) - 1;
+}
+
+static inline unsigned br_get(const uint64_t *w, unsigned width, size_t i)
+{
+	size_t per = BR_WORD_BITS / width;
+	unsigned shift = (unsigned)(i % per) * width;
+	return (unsigned)((w[i / per] >> shift) & br_mask(width));
+}
+
+static inline void br_set(uint64_t *w, unsigned width, size_t i, unsigned v)
+{
+	size_t per = BR_WORD_BITS / width;
+	unsigned shift = (unsigned)(i % per) * width;
+	uint64_t m = br_mask(width) << shift;
+	w[i / per] = (w[i / per] & ~m) | (((uint64_t)v << shift) & m);
+}
+
+/* The lowest bit of every field, times `v`: `v` in every field. */
+static inline uint64_t br_splat(unsigned width, unsigned v)
+{
+	return ~UINT64_C(0) / br_mask(width) * ((uint64_t)v & br_mask(width));
+}
+
+/* Sets the first `n` elements to `v`. */
+static inline void br_fill(uint64_t *w, unsigned width, size_t n, unsigned v)
+{
+	size_t per = BR_WORD_BITS / width;
+	size_t i;
+	if (v == 0 || v == br_mask(width)) {
+		memset(w, v == 0 ? 0 : 0xff, n / per * sizeof *w);
+	} else {
+		uint64_t pat = br_splat(width, v);
+		for (i = 0; i < n / per; ++i)
+			w[i] = pat;
+	}
+	for (i = n / per * per; i < n; ++i)
+		br_set(w, width, i, v);
+}
+
+/*
+ * The top bit of every field of `x` that's zero. Adding the low bits of a
+ * field to themselves carries into its top bit iff any of them is set, and
+ * can't carry out of the field.
+ */
+static inline uint64_t br_zeros(uint64_t x, uint64_t hi)
+{
+	return ~((((x & ~hi) + ~hi) | x)) & hi;
+}
+
+/* `br_zeros()` restricted to the fields of word `k` below element `n`. */
+static inline uint64_t br_tail(uint64_t m, unsigned width, size_t n,
+                               size_t k)
+{
+	size_t per = BR_WORD_BITS / width;
+	if (k == n / per && n % per != 0)
+		m &= (UINT64_C(1) << (n % per * width)) - 1;
+	return m;
+}
+
+static inline unsigned br_popcount(uint64_t x)
+{
+#if defined __GNUC__
+	return (unsigned)__builtin_popcountll(x);
+#else
+	unsigned c = 0;
+	for (; x != 0; x &= x - 1)
+		++c;
+	return c;
+#endif
+}
+
+static inline unsigned br_ctz(uint64_t x)
+{
+#if defined __GNUC__
+	return (unsigned)__builtin_ctzll(x);
+#else
+	unsigned c = 0;
+	for (; !(x & 1); x >>= 1)
+		++c;
+	return c;
+#endif
+}
+
+/* How many of the first `n` elements are equal to `v`. */
+static inline size_t br_count(const uint64_t *w, unsigned width, size_t n,
+                              unsigned v)
+{
+	size_t per = BR_WORD_BITS / width;
+	size_t nw = br_words(n, width);
+	uint64_t pat = br_splat(width, v);
+	uint64_t hi = br_splat(width, 1) << (width - 1);
+	size_t c = 0;
+	size_t k;
+	/* For 1-bit fields, this is a plain popcount of `w[k]` or `~w[k]`. */
+	for (k = 0; k < n / per; ++k)
+		c += br_popcount(br_zeros(w[k] ^ pat, hi));
+	if (k < nw)
+		c += br_popcount(br_tail(br_zeros(w[k] ^ pat, hi), width, n, k));
+	return c;
+}
+
+/*
+ * Index of the first element in `[from, n)` equal to `v`, or `n` if there's
+ * none.
+ */
+static inline size_t br_find(const uint64_t *w, unsigned width, size_t n,
+                             unsigned v, size_t from)
+{
+	size_t per = BR_WORD_BITS / width;
+	size_t nw = br_words(n, width);
+	uint64_t pat = br_splat(width, v);
+	uint64_t hi = br_splat(width, 1) << (width - 1);
+	size_t k = from / per;
+	uint64_t m;
+	if (from >= n)
+		return n;
+
+	/* The first word, without the fields before `from`. */
+	m = br_zeros(w[k] ^ pat, hi)
+	    & ~((UINT64_C(1) << (from % per * width)) - 1);
+	while (m == 0) {
+		if (++k >= nw)
+			return n;
+
+#if defined __AVX2__
+		{
+			const __m256i vpat = _mm256_set1_epi64x((long long)pat);
+			const __m256i vhi = _mm256_set1_epi64x((long long)hi);
+			const __m256i vlo = _mm256_set1_epi64x((long long)~hi);
+			/* Skip 4 words at a time, as long as none matches. */
+			for (; k + 4 < nw; k += 4) {
+				__m256i x = _mm256_xor_si256(
+					_mm256_loadu_si256((const __m256i *)(w + k)), vpat);
+				__m256i y = _mm256_or_si256(_mm256_add_epi64(
+					_mm256_and_si256(x, vlo), vlo), x);
+				if (!_mm256_testc_si256(y, vhi))
+					break;
+			}
+		}
+#elif defined __SSE2__ || defined _M_X64
+		{
+			const __m128i vpat = _mm_set1_epi64x((long long)pat);
+			const __m128i vhi = _mm_set1_epi64x((long long)hi);
+			const __m128i vlo = _mm_set1_epi64x((long long)~hi);
+			/* Skip 2 words at a time, as long as none matches. */
+			for (; k + 2 < nw; k += 2) {
+				__m128i x = _mm_xor_si128(
+					_mm_loadu_si128((const __m128i *)(w + k)), vpat);
+				__m128i y = _mm_or_si128(_mm_add_epi64(
+					_mm_and_si128(x, vlo), vlo), x);
+				/* Some top bit clear: some field matched. */
+				if (_mm_movemask_epi8(_mm_cmpeq_epi8(
+				        _mm_and_si128(y, vhi), vhi)) != 0xffff)
+					break;
+			}
+		}
+#endif
+		m = br_zeros(w[k] ^ pat, hi);
+	}
+
+	m = br_tail(m, width, n, k);
+	return m == 0 ? n : k * per + br_ctz(m) / width;
+}
+
+#endif  /* BR_H */
@@ -0,0 +1,293 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Scatter/gather I/O straight out of, and into, the regions of a laid-out
+ * block, without copying them into a staging buffer first.
+ *
+ * `blio_iov()` turns a block and its layouts into an `iovec` list, either
+ * covering the padding between regions too (`BLIO_PADDING`) or only the
+ * regions themselves (`BLIO_SKIP_PADDING`). Touching regions share one
+ * `iovec`. `blio_writev()` and `blio_readv()` then transfer the whole list,
+ * restarting on `EINTR` and after short transfers and splitting it into
+ * `IOV_MAX`-sized batches. `blio_writeblk()` and `blio_readblk()` do it all
+ * at once, the latter into a freshly allocated block.
+ *
+ * With `BLIO_SKIP_PADDING` the bytes on the wire don't depend on where the
+ * blocks are, so they can be read back into a block of any alignment that
+ * satisfies the layouts (`blio_readblk()` raises `align` to that). With
+ * `BLIO_PADDING`, both blocks must be aligned to the largest alignment among
+ * the layouts (true for `BL_ALIGNMENT` blocks and naturally-aligned types).
+ *
+ * Requires `preadv()`/`pwritev()` (`_DEFAULT_SOURCE` under glibc). Implemented
+ * as a "header library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define BLIO_API static  // Fine if used in a single translation unit.
+ * #define BLIO_IMPL        // Include the implementation here.
+ * #include "blio.h"        // blio_*()
+ *
+ * if (blio_writeblk(fd, -1, block, n, lays, BLIO_SKIP_PADDING) < 0)
+ *     return 1;
+ *
+ * // ...
+ *
+ * void *copy = blio_readblk(fd, -1, BL_ALIGNMENT, n, lays, BLIO_SKIP_PADDING);
+ * if (copy == NULL)
+ *     return 1;  // `errno` is `EIO` if the data ran out early.
+ * ```
+ */
+
+#ifndef BLIO_H
+#define BLIO_H
+
+#include "blayout.h"   /* struct blayout */
+#include <stddef.h>    /* size_t */
+#include <sys/types.h> /* off_t, ssize_t */
+#include <sys/uio.h>   /* struct iovec */
+
+#ifndef BLIO_API
+#	define BLIO_API
+#endif
+
+/* `blio_*blk()` use this many `iovec`s on the stack before `malloc()`ing. */
+#ifndef BLIO_STACK_IOV
+#	define BLIO_STACK_IOV 32
+#endif
+
+enum blio_flags {
+	BLIO_PADDING = 0,
+	BLIO_SKIP_PADDING = 1
+};
+
+/*
+ * Fills `iov` (room for `n` entries) with the regions of `block`, laid out
+ * with `blnext()`. Returns the number of entries used.
+ */
+BLIO_API size_t blio_iov(struct iovec *iov, void *block, size_t n,
+                         const struct blayout *lays, int flags);
+
+/*
+ * Writes/reads all of `iov[0..cnt)` at file offset `off`, or at the current
+ * one if `off` is negative. `iov` is consumed in the process. Return the
+ * number of bytes transferred, which is short only if `blio_readv()` reached
+ * the end of the file, or -1 with `errno` set.
+ */
+BLIO_API ssize_t blio_writev(int fd, struct iovec *iov, size_t cnt, off_t off);
+BLIO_API ssize_t blio_readv(int fd, struct iovec *iov, size_t cnt, off_t off);
+
+/* Writes `block` whole; returns the number of bytes written, or -1. */
+BLIO_API ssize_t blio_writeblk(int fd, off_t off, const void *block, size_t n,
+                               const struct blayout *lays, int flags);
+
+/*
+ * Reads a block written by `blio_writeblk()` into a new block, aligned to
+ * `align` or to the largest alignment among the layouts, whichever is larger,
+ * that must be freed with `free()`. Returns NULL with `errno` set on failure,
+ * and `EIO` if the data ended early.
+ */
+BLIO_API void *blio_readblk(int fd, off_t off, size_t align, size_t n,
+                            const struct blayout *lays, int flags);
+
+#endif  /* BLIO_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef BLIO_IMPL
+
+#include "blayout.h"  /* blcalc(), blnext(), blsizeof() */
+#include <errno.h>    /* errno, EINTR, EIO, EINVAL, ENOMEM */
+#include <limits.h>   /* IOV_MAX */
+#include <stdint.h>   /* uintptr_t */
+#include <stdlib.h>   /* malloc(), free(), posix_memalign() */
+#include <sys/uio.h>  /* readv(), writev(), preadv(), pwritev() */
+
+#ifndef IOV_MAX
+#	define IOV_MAX 16  /* The lowest POSIX allows. */
+#endif
+
+#ifdef __GNUC__
+#	define BLIO_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#	define BLIO_UNLIKELY(x) (x)
+#endif
+
+BLIO_API size_t blio_iov(struct iovec *iov, void *block, size_t n,
+                         const struct blayout *lays, int flags)
+{
+	char *p = block;
+	size_t prev_size = 0;
+	size_t cnt = 0;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		size_t size = blsizeof(&lays[i]);
+		p = blnext(p, prev_size, lays[i].align);
+		prev_size = size;
+		if (cnt > 0) {
+			struct iovec *last = &iov[cnt - 1];
+			char *start = last->iov_base;
+			/* Extend the last `iovec` over any padding, if allowed. */
+			if (start + last->iov_len == p || !(flags & BLIO_SKIP_PADDING)) {
+				last->iov_len = (size_t)(p - start) + size;
+				continue;
+			}
+		}
+		iov[cnt].iov_base = p;
+		iov[cnt].iov_len = size;
+		++cnt;
+	}
+	return cnt;
+}
+
+/* The common part of `blio_writev()` and `blio_readv()`. */
+static ssize_t blio_xfer(int fd, struct iovec *iov, size_t cnt, off_t off,
+                         int write)
+{
+	size_t total = 0;
+	while (cnt > 0) {
+		int batch = cnt > IOV_MAX ? IOV_MAX : (int)cnt;
+		ssize_t r;
+		if (write)
+			r = off < 0 ? writev(fd, iov, batch)
+			            : pwritev(fd, iov, batch, off + (off_t)total);
+		else
+			r = off < 0 ? readv(fd, iov, batch)
+			            : preadv(fd, iov, batch, off + (off_t)total);
+
+		if (BLIO_UNLIKELY(r < 0)) {
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+		if (r == 0) {
+			if (!write)
+				break;  /* End of file. */
+
+			errno = EIO;
+			return -1;
+		}
+
+		total += (size_t)r;
+		/* Skip what's done, and resume mid-`iovec` if need be. */
+		while (cnt > 0 && (size_t)r >= iov->iov_len) {
+			r -= (ssize_t)iov->iov_len;
+			++iov;
+			--cnt;
+		}
+		if (cnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + r;
+			iov->iov_len -= (size_t)r;
+		}
+	}
+	return (ssize_t)total;
+}
+
+BLIO_API ssize_t blio_writev(int fd, struct iovec *iov, size_t cnt, off_t off)
+{
+	return blio_xfer(fd, iov, cnt, off, 1);
+}
+
+BLIO_API ssize_t blio_readv(int fd, struct iovec *iov, size_t cnt, off_t off)
+{
+	return blio_xfer(fd, iov, cnt, off, 0);
+}
+
+/* Builds the `iovec` list for `block`, on the stack if small enough. */
+static struct iovec *blio_list(struct iovec *stack, size_t *cnt, void *block,
+                               size_t n, const struct blayout *lays, int flags)
+{
+	struct iovec *iov = stack;
+	if (n > BLIO_STACK_IOV) {
+		if (BLIO_UNLIKELY(n > (size_t)-1 / sizeof *iov)) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		iov = malloc(n * sizeof *iov);
+		if (BLIO_UNLIKELY(iov == NULL))
+			return NULL;
+	}
+	*cnt = blio_iov(iov, block, n, lays, flags);
+	return iov;
+}
+
+BLIO_API ssize_t blio_writeblk(int fd, off_t off, const void *block, size_t n,
+                               const struct blayout *lays, int flags)
+{
+	struct iovec stack[BLIO_STACK_IOV];
+	struct iovec *iov;
+	size_t cnt;
+	ssize_t r;
+	/* `writev()` doesn't write through `iov_base`. */
+	iov = blio_list(stack, &cnt, (void *)(uintptr_t)block, n, lays, flags);
+	if (BLIO_UNLIKELY(iov == NULL))
+		return -1;
+
+	r = blio_writev(fd, iov, cnt, off);
+	if (iov != stack)
+		free(iov);
+	return r;
+}
+
+BLIO_API void *blio_readblk(int fd, off_t off, size_t align, size_t n,
+                            const struct blayout *lays, int flags)
+{
+	struct iovec stack[BLIO_STACK_IOV];
+	struct iovec *iov;
+	void *block;
+	size_t size, want, cnt, i;
+	ssize_t r;
+	int err;
+	if (BLIO_UNLIKELY(n == 0 || align == 0 || (align & (align - 1)) != 0)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* The block is sized for, and allocated at, the same alignment. */
+	if (align < sizeof(void *))
+		align = sizeof(void *);
+	for (i = 0; i < n; ++i)
+		if (align < lays[i].align)
+			align = lays[i].align;
+	size = blcalc(align, 0, n, lays, 0);
+	if (BLIO_UNLIKELY(size == 0)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	err = posix_memalign(&block, align, size);
+	if (BLIO_UNLIKELY(err != 0)) {
+		errno = err;
+		return NULL;
+	}
+
+	iov = blio_list(stack, &cnt, block, n, lays, flags);
+	if (BLIO_UNLIKELY(iov == NULL))
+		goto error;
+
+	for (want = 0, i = 0; i < cnt; ++i)
+		want += iov[i].iov_len;
+	r = blio_readv(fd, iov, cnt, off);
+	if (iov != stack)
+		free(iov);
+	if (BLIO_UNLIKELY(r < 0))
+		goto error;
+
+	if (BLIO_UNLIKELY((size_t)r != want)) {
+		errno = EIO;
+		goto error;
+	}
+	return block;
+
+error:
+	err = errno;
+	free(block);
+	errno = err;
+	return NULL;
+}
+
+#undef BLIO_UNLIKELY
+
+#undef BLIO_IMPL
+#endif  /* BLIO_IMPL */
@@ -0,0 +1,146 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Whole-block hashing and equality.
+ *
+ * The padding between the regions of a block is indeterminate, so two blocks
+ * holding equal regions needn't be equal byte for byte. `bh_scrub()` zeroes
+ * every gap the layouts leave (the padding in front of each region and after
+ * the last one), after which `bh_hash()` and `bh_equal()` can treat the block
+ * as plain bytes: one linear pass, instead of one call per region.
+ *
+ * Scrub again after anything that may write padding, such as assigning a
+ * whole `struct` into the block. Padding _inside_ elements (e.g. that of a
+ * `struct` type) isn't known to the layouts, so it's not scrubbed.
+ *
+ * `bh_hash()` keeps four independent 64-bit lanes, each fed 8 bytes out of
+ * every 32, so the main loop has no dependencies between lanes and compilers
+ * can vectorize it. Results depend on the byte order of the machine.
+ *
+ * Everything is `static inline`. Example usage:
+ * ```c
+ * #include "block-hash.h"  // bh_scrub(), bh_hash(), bh_equal()
+ *
+ * size_t size = blcalc(BL_ALIGNMENT, 0, n, lays, 0);
+ * // ... Fill `a` and `b`, each `size` bytes.
+ * bh_scrub(a, size, n, lays);
+ * bh_scrub(b, size, n, lays);
+ * if (bh_hash(a, size, 0) == bh_hash(b, size, 0) && bh_equal(a, b, size))
+ *     // ... Duplicates.
+ * ```
+ */
+
+#ifndef BH_H
+#define BH_H
+
+#include "blayout.h"  /* struct blayout, blnext(), blsizeof() */
+#include <stddef.h>   /* size_t */
+#include <stdint.h>   /* uint64_t, uint32_t */
+#include <string.h>   /* memcpy(), memset(), memcmp() */
+
+/*
+ * Zeroes every byte of the `size`-byte block that isn't part of one of its
+ * `n` regions, as placed by `blnext()`.
+ */
+static inline void bh_scrub(void *block, size_t size, size_t n,
+                            const struct blayout *lays)
+{
+	char *p = (char *)block;
+	char *end = p;  /* Of the last region so far. */
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		p = (char *)blnext(p, (size_t)(end - p), lays[i].align);
+		memset(end, 0, (size_t)(p - end));
+		end = p + blsizeof(&lays[i]);
+	}
+	memset(end, 0, size - (size_t)(end - (char *)block));
+}
+
+#define BH_P1 UINT64_C(0x9e3779b185ebca87)
+#define BH_P2 UINT64_C(0xc2b2ae3d27d4eb4f)
+#define BH_P3 UINT64_C(0x165667b19e3779f9)
+#define BH_P4 UINT64_C(0x85ebca77c2b2ae63)
+#define BH_P5 UINT64_C(0x27d4eb2f165667c5)
+
+static inline uint64_t bh_rotl(uint64_t x, unsigned r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t bh_read64(const unsigned char *p)
+{
+	uint64_t x;
+	memcpy(&x, p, sizeof x);
+	return x;
+}
+
+static inline uint64_t bh_round(uint64_t acc, uint64_t x)
+{
+	return bh_rotl(acc + x * BH_P2, 31) * BH_P1;
+}
+
+static inline uint64_t bh_merge(uint64_t h, uint64_t v)
+{
+	return (h ^ bh_round(0, v)) * BH_P1 + BH_P4;
+}
+
+/* Hashes `size` bytes at `p`; equal bytes and seeds give equal hashes. */
+static inline uint64_t bh_hash(const void *p, size_t size, uint64_t seed)
+{
+	const unsigned char *b = (const unsigned char *)p;
+	const unsigned char *end = b + size;
+	uint64_t h;
+	if (size >= 32) {
+		uint64_t v[4];
+		int k;
+		v[0] = seed + BH_P1 + BH_P2;
+		v[1] = seed + BH_P2;
+		v[2] = seed;
+		v[3] = seed - BH_P1;
+		for (; end - b >= 32; b += 32)
+			for (k = 0; k < 4; ++k)
+				v[k] = bh_round(v[k], bh_read64(b + 8 * k));
+
+		h = bh_rotl(v[0], 1) + bh_rotl(v[1], 7) + bh_rotl(v[2], 12)
+		    + bh_rotl(v[3], 18);
+		for (k = 0; k < 4; ++k)
+			h = bh_merge(h, v[k]);
+	} else {
+		h = seed + BH_P5;
+	}
+
+	h += (uint64_t)size;
+	for (; end - b >= 8; b += 8)
+		h = bh_rotl(h ^ bh_round(0, bh_read64(b)), 27) * BH_P1 + BH_P4;
+	if (end - b >= 4) {
+		uint32_t x;
+		memcpy(&x, b, sizeof x);
+		h = bh_rotl(h ^ (uint64_t)x * BH_P1, 23) * BH_P2 + BH_P3;
+		b += 4;
+	}
+	for (; b < end; ++b)
+		h = bh_rotl(h ^ *b * BH_P5, 11) * BH_P1;
+
+	/* Final avalanche. */
+	h ^= h >> 33;
+	h *= BH_P2;
+	h ^= h >> 29;
+	h *= BH_P3;
+	h ^= h >> 32;
+	return h;
+}
+
+/* Whether two scrubbed `size`-byte blocks hold equal regions. */
+static inline int bh_equal(const void *a, const void *b, size_t size)
+{
+	return memcmp(a, b, size) == 0;
+}
+
+#undef BH_P5
+#undef BH_P4
+#undef BH_P3
+#undef BH_P2
+#undef BH_P1
+
+#endif  /* BH_H */
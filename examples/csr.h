@@ -0,0 +1,518 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * A read-only compressed-sparse-row (CSR) graph stored in a _single_ block:
+ *
+ *   | header | row offsets | column indices | edge weights | node attributes |
+ *
+ * Every array is `CSR_ALIGN`-aligned (a cache line, enough for any SIMD
+ * load) and its offset from the start of the block depends on nothing but
+ * the header. The block is therefore position-independent: `csr_save()`
+ * writes it out verbatim and `csr_load()` maps it back with one `mmap()`.
+ *
+ * `csr_build()` builds a graph from an edge list using `nthreads` POSIX
+ * threads. The neighbors of each node end up sorted by column index (then
+ * weight), so the result doesn't depend on the number of threads.
+ *
+ * Requires POSIX (`_POSIX_C_SOURCE >= 200809L`). Implemented as a "header
+ * library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define CSR_API static  // Fine if used in a single translation unit.
+ * #define CSR_IMPL        // Include the implementation here.
+ * #include "csr.h"        // struct csr, struct csr_edge, csr_*()
+ *
+ * const struct csr_edge e[] = {{0, 1, 1.0f}, {1, 2, 0.5f}, {0, 2, 2.0f}};
+ * struct csr g;
+ * if (csr_build(&g, 3, e, 3, 0, 4) != 0 || csr_save(&g, "g.csr") != 0)
+ *     return 1;
+ * csr_free(&g);
+ *
+ * if (csr_load(&g, "g.csr") != 0)
+ *     return 1;
+ * for (uint64_t i = g.rows[0]; i < g.rows[1]; ++i)
+ *     printf("0 -> %u (%f)\n", g.cols[i], g.weights[i]);
+ * csr_free(&g);
+ * ```
+ */
+
+#ifndef CSR_H
+#define CSR_H
+
+#include <stddef.h>  /* size_t */
+#include <stdint.h>  /* uint32_t, uint64_t */
+
+#ifndef CSR_API
+#	define CSR_API
+#endif
+
+#define CSR_ALIGN 64
+
+struct csr_edge {
+	uint32_t src;
+	uint32_t dst;
+	float weight;
+};
+
+/* Lives at the start of the block, and so at the start of the file. */
+struct csr_hdr {
+	char magic[8];       /* "BLCSR\0\0\0" */
+	uint32_t byteorder;  /* 0x01020304 in native order. */
+	uint32_t attr_size;  /* Bytes of attributes per node; may be 0. */
+	uint64_t nnodes;
+	uint64_t nedges;
+	uint64_t size;       /* Of the whole block. */
+};
+
+struct csr {
+	void *blk;
+	size_t size;
+	int mapped;
+	const struct csr_hdr *hdr;
+	uint64_t *rows;   /* `nnodes + 1` offsets into `cols` and `weights`. */
+	uint32_t *cols;   /* `nedges` destination nodes. */
+	float *weights;   /* `nedges` edge weights. */
+	void *attrs;      /* `nnodes * attr_size` bytes or `NULL`. */
+};
+
+/*
+ * Allocates a zeroed graph. `rows`, `cols`, `weights` and `attrs` are up to
+ * the caller. Returns 0 on success or -1 with `errno` set.
+ */
+CSR_API int csr_alloc(struct csr *g, uint64_t nnodes, uint64_t nedges,
+                      uint32_t attr_size);
+
+/* Builds from `nedges` edges. Node ids must be less than `nnodes`. */
+CSR_API int csr_build(struct csr *g, uint64_t nnodes,
+                      const struct csr_edge *edges, uint64_t nedges,
+                      uint32_t attr_size, unsigned nthreads);
+
+CSR_API int csr_save(const struct csr *g, const char *path);
+
+/* Maps `path` read-only; don't write through the graph's pointers. */
+CSR_API int csr_load(struct csr *g, const char *path);
+
+CSR_API void csr_free(struct csr *g);
+
+#endif  /* CSR_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef CSR_IMPL
+
+#ifndef AM_H
+#	define AM_API static
+#	define AM_IMPL
+#endif
+#include "aligned-malloc.h"  /* aligned_malloc(), aligned_free() */
+/* struct blayout, blcalc(), blnext(), blsizeof(), blaligned() */
+#include "blayout.h"
+#include <errno.h>       /* errno, EINTR, EINVAL, ENOMEM */
+#include <fcntl.h>       /* open() */
+#include <pthread.h>     /* pthread_*() */
+#include <stdlib.h>      /* malloc(), free() */
+#include <string.h>      /* memcpy(), memcmp(), memset() */
+#include <sys/mman.h>    /* mmap(), munmap() */
+#include <sys/stat.h>    /* fstat() */
+#include <unistd.h>      /* write(), close() */
+
+#ifdef __GNUC__
+#	define CSR_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#	define CSR_UNLIKELY(x) (x)
+#endif
+
+static const char csr_magic[8] = "BLCSR";
+
+/* Empty arrays still get an element, so that every layout is valid. */
+#define CSR_NMEMB(n) ((n) > 0 ? (size_t)(n) : 1)
+
+static size_t csr_layout(struct blayout l[5], uint64_t nnodes,
+                         uint64_t nedges, uint32_t attr_size)
+{
+	size_t n = attr_size > 0 ? 5 : 4;
+	if (CSR_UNLIKELY(nnodes >= SIZE_MAX || nedges > SIZE_MAX))
+		return 0;
+
+	l[0].nmemb = 1;
+	l[0].size = sizeof(struct csr_hdr);
+	l[0].align = CSR_ALIGN;
+	l[1].nmemb = (size_t)nnodes + 1;
+	l[1].size = sizeof(uint64_t);
+	l[1].align = CSR_ALIGN;
+	l[2].nmemb = CSR_NMEMB(nedges);
+	l[2].size = sizeof(uint32_t);
+	l[2].align = CSR_ALIGN;
+	l[3].nmemb = CSR_NMEMB(nedges);
+	l[3].size = sizeof(float);
+	l[3].align = CSR_ALIGN;
+	l[4].nmemb = CSR_NMEMB(nnodes);
+	l[4].size = attr_size;
+	l[4].align = CSR_ALIGN;
+	{
+		size_t size = blcalc(CSR_ALIGN, 0, n, l, 0);
+		return size == 0 ? 0 : blaligned(size, CSR_ALIGN);
+	}
+}
+
+static void csr_carve(struct csr *g, void *blk, const struct blayout l[5],
+                      uint32_t attr_size)
+{
+	g->hdr = blnext(blk, 0, l[0].align);
+	g->rows = blnext((void *)g->hdr, blsizeof(&l[0]), l[1].align);
+	g->cols = blnext(g->rows, blsizeof(&l[1]), l[2].align);
+	g->weights = blnext(g->cols, blsizeof(&l[2]), l[3].align);
+	g->attrs = attr_size == 0 ? NULL
+	         : blnext(g->weights, blsizeof(&l[3]), l[4].align);
+}
+
+CSR_API int csr_alloc(struct csr *g, uint64_t nnodes, uint64_t nedges,
+                      uint32_t attr_size)
+{
+	struct blayout l[5];
+	struct csr_hdr *hdr;
+	size_t size = csr_layout(l, nnodes, nedges, attr_size);
+	if (CSR_UNLIKELY(size == 0)) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	g->blk = aligned_malloc(CSR_ALIGN, size);
+	if (CSR_UNLIKELY(g->blk == NULL))
+		return -1;
+
+	memset(g->blk, 0, size);
+	g->size = size;
+	g->mapped = 0;
+	csr_carve(g, g->blk, l, attr_size);
+
+	hdr = (struct csr_hdr *)g->blk;
+	memcpy(hdr->magic, csr_magic, sizeof hdr->magic);
+	hdr->byteorder = 0x01020304;
+	hdr->attr_size = attr_size;
+	hdr->nnodes = nnodes;
+	hdr->nedges = nedges;
+	hdr->size = size;
+	return 0;
+}
+
+CSR_API void csr_free(struct csr *g)
+{
+	if (g->mapped)
+		munmap(g->blk, g->size);
+	else
+		aligned_free(g->blk);
+	g->blk = NULL;
+}
+
+
+/*
+ * Parallel build. Every worker runs all phases, separated by barriers:
+ *
+ *  1. Count out-degrees into `rows[src + 1]` (atomically).
+ *  2. Sum its slice of `rows`; worker 0 scans the per-worker sums.
+ *  3. Turn its slice into a prefix sum, offset by the scanned sums.
+ *  4. Scatter its slice of the edges, claiming slots with atomic cursors.
+ *  5. Sort the neighbors of the nodes in its slice.
+ */
+
+struct csr_build_ctx {
+	struct csr *g;
+	const struct csr_edge *edges;
+	uint64_t *cursor;
+	uint64_t *sums;
+	pthread_barrier_t barrier;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int go;  /* 0: wait, 1: run, -1: bail out. */
+	unsigned nthreads;
+};
+
+struct csr_worker {
+	struct csr_build_ctx *ctx;
+	unsigned id;
+};
+
+/* `n * i / t` without overflowing. */
+#define CSR_SLICE(n, t, i) ((n) / (t) * (i) + (n) % (t) * (i) / (t))
+
+static void csr_sift(uint32_t *c, float *w, uint64_t i, uint64_t n)
+{
+	for (;;) {
+		uint64_t m = i;
+		uint64_t l = 2 * i + 1;
+		uint64_t r = l + 1;
+		if (l < n && (c[l] > c[m] || (c[l] == c[m] && w[l] > w[m])))
+			m = l;
+		if (r < n && (c[r] > c[m] || (c[r] == c[m] && w[r] > w[m])))
+			m = r;
+		if (m == i)
+			return;
+
+		{
+			uint32_t tc = c[i];
+			float tw = w[i];
+			c[i] = c[m];
+			w[i] = w[m];
+			c[m] = tc;
+			w[m] = tw;
+		}
+		i = m;
+	}
+}
+
+/* Heapsort, so that hubs don't go quadratic. */
+static void csr_sort(uint32_t *c, float *w, uint64_t n)
+{
+	uint64_t i;
+	for (i = n / 2; i-- > 0;)
+		csr_sift(c, w, i, n);
+
+	for (i = n; i-- > 1;) {
+		uint32_t tc = c[0];
+		float tw = w[0];
+		c[0] = c[i];
+		w[0] = w[i];
+		c[i] = tc;
+		w[i] = tw;
+		csr_sift(c, w, 0, i);
+	}
+}
+
+static void *csr_work(void *arg)
+{
+	struct csr_worker *wk = arg;
+	struct csr_build_ctx *ctx = wk->ctx;
+	struct csr *g = ctx->g;
+	uint64_t nnodes = g->hdr->nnodes;
+	uint64_t nedges = g->hdr->nedges;
+	unsigned t = ctx->nthreads;
+	uint64_t e0 = CSR_SLICE(nedges, t, wk->id);
+	uint64_t e1 = CSR_SLICE(nedges, t, wk->id + 1);
+	uint64_t n0 = CSR_SLICE(nnodes, t, wk->id);
+	uint64_t n1 = CSR_SLICE(nnodes, t, wk->id + 1);
+	uint64_t i;
+	uint64_t sum = 0;
+	int go;
+
+	pthread_mutex_lock(&ctx->lock);
+	while ((go = ctx->go) == 0)
+		pthread_cond_wait(&ctx->cond, &ctx->lock);
+	pthread_mutex_unlock(&ctx->lock);
+	if (go < 0)
+		return NULL;
+
+	for (i = e0; i < e1; ++i)
+		__atomic_fetch_add(&g->rows[ctx->edges[i].src + 1], 1,
+		                   __ATOMIC_RELAXED);
+	pthread_barrier_wait(&ctx->barrier);
+
+	for (i = n0; i < n1; ++i)
+		sum += g->rows[i + 1];
+	ctx->sums[wk->id] = sum;
+	if (pthread_barrier_wait(&ctx->barrier) == PTHREAD_BARRIER_SERIAL_THREAD) {
+		uint64_t acc = 0;
+		unsigned j;
+		for (j = 0; j < t; ++j) {
+			uint64_t s = ctx->sums[j];
+			ctx->sums[j] = acc;
+			acc += s;
+		}
+	}
+	pthread_barrier_wait(&ctx->barrier);
+
+	sum = ctx->sums[wk->id];
+	for (i = n0; i < n1; ++i) {
+		sum += g->rows[i + 1];
+		g->rows[i + 1] = sum;
+		ctx->cursor[i] = i == n0 ? ctx->sums[wk->id] : g->rows[i];
+	}
+	pthread_barrier_wait(&ctx->barrier);
+
+	for (i = e0; i < e1; ++i) {
+		const struct csr_edge *e = &ctx->edges[i];
+		uint64_t slot = __atomic_fetch_add(&ctx->cursor[e->src], 1,
+		                                   __ATOMIC_RELAXED);
+		g->cols[slot] = e->dst;
+		g->weights[slot] = e->weight;
+	}
+	pthread_barrier_wait(&ctx->barrier);
+
+	for (i = n0; i < n1; ++i) {
+		uint64_t b = g->rows[i];
+		csr_sort(g->cols + b, g->weights + b, g->rows[i + 1] - b);
+	}
+	return NULL;
+}
+
+CSR_API int csr_build(struct csr *g, uint64_t nnodes,
+                      const struct csr_edge *edges, uint64_t nedges,
+                      uint32_t attr_size, unsigned nthreads)
+{
+	struct csr_build_ctx ctx;
+	pthread_t tids[64];
+	struct csr_worker wks[64];
+	unsigned started;
+	unsigned j;
+	int err = 0;
+	uint64_t i;
+
+	for (i = 0; i < nedges; ++i) {
+		if (CSR_UNLIKELY(edges[i].src >= nnodes || edges[i].dst >= nnodes)) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	if (nthreads == 0)
+		nthreads = 1;
+	if (nthreads > sizeof tids / sizeof tids[0])
+		nthreads = sizeof tids / sizeof tids[0];
+
+	if (csr_alloc(g, nnodes, nedges, attr_size) != 0)
+		return -1;
+
+	ctx.g = g;
+	ctx.edges = edges;
+	ctx.nthreads = nthreads;
+	ctx.sums = malloc(nthreads * sizeof *ctx.sums);
+	ctx.cursor = malloc(CSR_NMEMB(nnodes) * sizeof *ctx.cursor);
+	if (CSR_UNLIKELY(ctx.sums == NULL || ctx.cursor == NULL)) {
+		err = ENOMEM;
+		goto out;
+	}
+
+	err = pthread_barrier_init(&ctx.barrier, NULL, nthreads);
+	if (CSR_UNLIKELY(err != 0))
+		goto out;
+
+	pthread_mutex_init(&ctx.lock, NULL);
+	pthread_cond_init(&ctx.cond, NULL);
+	ctx.go = 0;
+
+	/*
+	 * The caller is worker 0. Workers are held at a gate until all of them
+	 * exist, since the barrier can't cope with a missing one.
+	 */
+	for (started = 1; started < nthreads; ++started) {
+		wks[started].ctx = &ctx;
+		wks[started].id = started;
+		err = pthread_create(&tids[started], NULL, csr_work, &wks[started]);
+		if (CSR_UNLIKELY(err != 0))
+			break;
+	}
+
+	pthread_mutex_lock(&ctx.lock);
+	ctx.go = started == nthreads ? 1 : -1;
+	pthread_cond_broadcast(&ctx.cond);
+	pthread_mutex_unlock(&ctx.lock);
+
+	wks[0].ctx = &ctx;
+	wks[0].id = 0;
+	if (started == nthreads)
+		csr_work(&wks[0]);
+	for (j = 1; j < started; ++j)
+		pthread_join(tids[j], NULL);
+
+	pthread_cond_destroy(&ctx.cond);
+	pthread_mutex_destroy(&ctx.lock);
+	pthread_barrier_destroy(&ctx.barrier);
+
+out:
+	free(ctx.cursor);
+	free(ctx.sums);
+	if (CSR_UNLIKELY(err != 0)) {
+		csr_free(g);
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+CSR_API int csr_save(const struct csr *g, const char *path)
+{
+	const char *p = g->blk;
+	size_t left = g->size;
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return -1;
+
+	while (left > 0) {
+		ssize_t r = write(fd, p, left);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+
+			{
+				int err = errno;
+				close(fd);
+				errno = err;
+			}
+			return -1;
+		}
+		p += r;
+		left -= (size_t)r;
+	}
+	return close(fd);
+}
+
+CSR_API int csr_load(struct csr *g, const char *path)
+{
+	struct stat st;
+	struct blayout l[5];
+	const struct csr_hdr *hdr;
+	void *blk;
+	int err = EINVAL;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	if (fstat(fd, &st) != 0) {
+		err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	if (CSR_UNLIKELY((uint64_t)st.st_size < sizeof *hdr
+	                 || (uint64_t)st.st_size > SIZE_MAX)) {
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* The one and only `mmap()`. The header is validated afterwards. */
+	blk = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	err = errno;
+	close(fd);
+	if (blk == MAP_FAILED) {
+		errno = err;
+		return -1;
+	}
+
+	hdr = blk;
+	if (CSR_UNLIKELY(memcmp(hdr->magic, csr_magic, sizeof hdr->magic) != 0
+	                 || hdr->byteorder != 0x01020304
+	                 || hdr->size != (uint64_t)st.st_size
+	                 || csr_layout(l, hdr->nnodes, hdr->nedges,
+	                               hdr->attr_size) != hdr->size)) {
+		munmap(blk, (size_t)st.st_size);
+		errno = EINVAL;
+		return -1;
+	}
+
+	g->blk = blk;
+	g->size = (size_t)st.st_size;
+	g->mapped = 1;
+	csr_carve(g, blk, l, hdr->attr_size);
+	return 0;
+}
+
+#undef CSR_SLICE
+#undef CSR_NMEMB
+#undef CSR_UNLIKELY
+
+#undef CSR_IMPL
+#endif  /* CSR_IMPL */
@@ -0,0 +1,311 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * A cache of computed layouts, for code that builds the same `struct blayout`
+ * arrays over and over and recomputes `blcalc()` and the offsets of the
+ * regions every time. `lc_get()` hashes the contents of the array, along with
+ * the alignment and offset of the block, and returns an interned `struct
+ * lc_shape`: the size, the offset of every region and the largest alignment.
+ * A shape seen before costs a hash and a probe, instead of a walk.
+ *
+ * The cache is a fixed-size open-addressing table of pointers to immutable
+ * shapes. Lookups are lock-free, with one acquire load per probed slot. New
+ * shapes are published with a compare-and-swap; when two threads race to add
+ * the same shape, one of them throws its copy away. Shapes are never evicted,
+ * so the returned pointers stay valid until `lc_destroy()`, and the capacity
+ * given to `lc_init()` must cover every distinct shape: past it, `lc_get()`
+ * fails with `ENOSPC` and the caller has to fall back to `blcalc()`.
+ *
+ * Hits and misses are counted with relaxed atomics, unless `LC_COUNTERS` is
+ * defined to 0. The counters are shared by every thread, so under heavy
+ * concurrent use they cost more than the lookups themselves.
+ *
+ * Requires GCC/Clang `__atomic` builtins. Implemented as a "header library",
+ * like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define LC_API static      // Fine if used in a single translation unit.
+ * #define LC_IMPL            // Include the implementation here.
+ * #include "layout-cache.h"  // struct lc_cache, struct lc_shape, lc_*()
+ *
+ * static struct lc_cache cache;  // `lc_init(&cache, 1024)` once, at startup.
+ *
+ * const struct blayout lays[] = {{n, sizeof(int), alignof(int)},
+ *                                {m, sizeof(double), alignof(double)}};
+ * const struct lc_shape *s = lc_get(&cache, BL_ALIGNMENT, 0, 2, lays);
+ * if (s == NULL || s->size == 0)
+ *     return 1;
+ *
+ * char *block = malloc(s->size);
+ * double *d = (double *)(block + s->offsets[1]);
+ * ```
+ */
+
+#ifndef LC_H
+#define LC_H
+
+#include "blayout.h"  /* struct blayout */
+#include <stddef.h>   /* size_t, ptrdiff_t */
+#include <stdint.h>   /* uint64_t */
+
+#ifndef LC_API
+#	define LC_API
+#endif
+
+#ifndef LC_COUNTERS
+#	define LC_COUNTERS 1
+#endif
+
+struct lc_shape {
+	size_t size;            /* As from `blcalc()`; 0 if it overflows. */
+	size_t max_align;       /* Largest among the layouts. */
+	size_t n;
+	const size_t *offsets;  /* From `block + offs`, as `blnext()` would. */
+
+	/* The key. */
+	uint64_t hash;
+	size_t align;
+	ptrdiff_t offs;
+	const struct blayout *lays;
+};
+
+struct lc_cache {
+	struct lc_shape **slots;  /* Accessed atomically. */
+	size_t mask;
+	size_t limit;
+	size_t count;             /* Accessed atomically. */
+	unsigned long long hits;  /* Accessed atomically. */
+	unsigned long long misses;
+};
+
+/* Room for at least `capacity` shapes. Returns 0, or -1 and `errno`. */
+LC_API int lc_init(struct lc_cache *c, size_t capacity);
+
+/* Frees every shape. Nobody else may be using the cache. */
+LC_API void lc_destroy(struct lc_cache *c);
+
+/*
+ * Returns the shape of a block laid out like `blcalc(align, offs, n, lays, 0)`
+ * would, or NULL and `errno` (`EINVAL` if `n` is 0, `ENOSPC` if the cache is
+ * full, `ENOMEM`). `align` and `offs` are assumed to be valid, as for
+ * `blcalc()`. Layouts whose size overflows are cached too, with a `size` of 0.
+ */
+LC_API const struct lc_shape *lc_get(struct lc_cache *c, size_t align,
+                                     ptrdiff_t offs, size_t n,
+                                     const struct blayout *lays);
+
+/* Either pointer may be NULL. Always 0 without `LC_COUNTERS`. */
+LC_API void lc_counters(const struct lc_cache *c, unsigned long long *hits,
+                        unsigned long long *misses);
+
+#endif  /* LC_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef LC_IMPL
+
+/* BL_ALIGNMENT, blcalc(), blnext(), blsizeof(), blbuild_init(), blextend() */
+#include "blayout.h"
+#include <errno.h>   /* errno, EINVAL, ENOMEM, ENOSPC */
+#include <stdlib.h>  /* malloc(), calloc(), free() */
+#include <string.h>  /* memcpy(), memcmp() */
+
+#if !defined __GNUC__
+#	error "`layout-cache.h` requires GCC or Clang `__atomic` builtins"
+#endif
+
+#define LC_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+#if LC_COUNTERS
+#	define LC_COUNT(p) __atomic_fetch_add(p, 1, __ATOMIC_RELAXED)
+#else
+#	define LC_COUNT(p) ((void)(p))
+#endif
+
+LC_API int lc_init(struct lc_cache *c, size_t capacity)
+{
+	size_t slots = 16;
+	/* At most half full, so that probe sequences stay short. */
+	while (slots / 2 < capacity) {
+		if (LC_UNLIKELY(slots > (size_t)-1 / 2 / sizeof *c->slots)) {
+			errno = ENOMEM;
+			return -1;
+		}
+		slots *= 2;
+	}
+
+	c->slots = (struct lc_shape **)calloc(slots, sizeof *c->slots);
+	if (LC_UNLIKELY(c->slots == NULL))
+		return -1;
+
+	c->mask = slots - 1;
+	c->limit = slots / 2;
+	c->count = 0;
+	c->hits = 0;
+	c->misses = 0;
+	return 0;
+}
+
+LC_API void lc_destroy(struct lc_cache *c)
+{
+	size_t i;
+	for (i = 0; i <= c->mask; ++i)
+		free(c->slots[i]);
+	free(c->slots);
+	c->slots = NULL;
+}
+
+static uint64_t lc_mix(uint64_t h, uint64_t v)
+{
+	h = (h ^ v) * UINT64_C(0x9e3779b97f4a7c15);
+	return h ^ (h >> 32);
+}
+
+static uint64_t lc_hash(size_t align, ptrdiff_t offs, size_t n,
+                        const struct blayout *lays)
+{
+	uint64_t h = lc_mix(lc_mix(n, align), (uint64_t)offs);
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		h = lc_mix(h, lays[i].nmemb);
+		h = lc_mix(h, lays[i].size);
+		h = lc_mix(h, lays[i].align);
+	}
+	/* Finalizer from MurmurHash3. */
+	h ^= h >> 33;
+	h *= UINT64_C(0xff51afd7ed558ccd);
+	h ^= h >> 33;
+	return h;
+}
+
+static int lc_match(const struct lc_shape *s, uint64_t hash, size_t align,
+                    ptrdiff_t offs, size_t n, const struct blayout *lays)
+{
+	return s->hash == hash && s->align == align && s->offs == offs
+	       && s->n == n && memcmp(s->lays, lays, n * sizeof *lays) == 0;
+}
+
+/*
+ * A shape, its copy of the key and its offsets are laid out in one block:
+ * {struct lc_shape}, {struct blayout x n}, {size_t x n}.
+ */
+static struct lc_shape *lc_make(uint64_t hash, size_t align, ptrdiff_t offs,
+                                size_t n, const struct blayout *lays)
+{
+	struct blayout l[3];
+	struct blbuild b;
+	struct lc_shape *s;
+	struct blayout *key;
+	size_t *offsets;
+	size_t size, i;
+	l[0].nmemb = 1;
+	l[0].size = sizeof *s;
+	l[0].align = BL_ALIGNMENT;
+	l[1].nmemb = n;
+	l[1].size = sizeof *key;
+	l[1].align = sizeof(blsize);
+	l[2].nmemb = n;
+	l[2].size = sizeof *offsets;
+	l[2].align = sizeof(size_t);
+	size = blcalc(BL_ALIGNMENT, 0, 3, l, 0);
+	if (LC_UNLIKELY(size == 0)) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	s = (struct lc_shape *)malloc(size);
+	if (LC_UNLIKELY(s == NULL))
+		return NULL;
+
+	key = (struct blayout *)blnext(s, sizeof *s, l[1].align);
+	offsets = (size_t *)blnext(key, blsizeof(&l[1]), l[2].align);
+	memcpy(key, lays, n * sizeof *lays);
+
+	blbuild_init(&b, align, offs);
+	for (i = 0; i < n; ++i)
+		offsets[i] = blextend(&b, lays[i].nmemb, lays[i].size,
+		                      lays[i].align);
+	s->size = blfinish(&b, &s->max_align);
+	s->n = n;
+	s->offsets = offsets;
+	s->hash = hash;
+	s->align = align;
+	s->offs = offs;
+	s->lays = key;
+	return s;
+}
+
+LC_API const struct lc_shape *lc_get(struct lc_cache *c, size_t align,
+                                     ptrdiff_t offs, size_t n,
+                                     const struct blayout *lays)
+{
+	uint64_t hash;
+	struct lc_shape *s, *mine;
+	size_t i;
+	if (LC_UNLIKELY(n == 0)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	hash = lc_hash(align, offs, n, lays);
+	for (i = (size_t)hash & c->mask;; i = (i + 1) & c->mask) {
+		s = __atomic_load_n(&c->slots[i], __ATOMIC_ACQUIRE);
+		if (s == NULL)
+			break;
+
+		if (lc_match(s, hash, align, offs, n, lays)) {
+			LC_COUNT(&c->hits);
+			return s;
+		}
+	}
+
+	LC_COUNT(&c->misses);
+	if (LC_UNLIKELY(__atomic_fetch_add(&c->count, 1, __ATOMIC_RELAXED)
+	                >= c->limit)) {
+		__atomic_fetch_sub(&c->count, 1, __ATOMIC_RELAXED);
+		errno = ENOSPC;
+		return NULL;
+	}
+
+	mine = lc_make(hash, align, offs, n, lays);
+	if (LC_UNLIKELY(mine == NULL)) {
+		__atomic_fetch_sub(&c->count, 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	/*
+	 * Slot `i` was empty. Whoever else is adding the same shape probes the
+	 * same sequence, so if we lose a race for a slot, either the winner is
+	 * our shape, or we keep going.
+	 */
+	for (;; i = (i + 1) & c->mask) {
+		s = NULL;
+		if (__atomic_compare_exchange_n(&c->slots[i], &s, mine, 0,
+		                                __ATOMIC_RELEASE,
+		                                __ATOMIC_ACQUIRE))
+			return mine;
+
+		if (lc_match(s, hash, align, offs, n, lays)) {
+			__atomic_fetch_sub(&c->count, 1, __ATOMIC_RELAXED);
+			free(mine);
+			return s;
+		}
+	}
+}
+
+LC_API void lc_counters(const struct lc_cache *c, unsigned long long *hits,
+                        unsigned long long *misses)
+{
+	if (hits != NULL)
+		*hits = __atomic_load_n(&c->hits, __ATOMIC_RELAXED);
+	if (misses != NULL)
+		*misses = __atomic_load_n(&c->misses, __ATOMIC_RELAXED);
+}
+
+#undef LC_COUNT
+#undef LC_UNLIKELY
+
+#undef LC_IMPL
+#endif  /* LC_IMPL */
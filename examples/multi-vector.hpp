@@ -0,0 +1,393 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Co-allocation for C++17 and later. Two pieces:
+ *
+ *  - `bl::block_resource`, a `std::pmr::memory_resource` which sizes a single
+ *    block with `blcalc()` and hands out its regions, in order, to whatever
+ *    allocates from it (e.g. a bunch of `std::pmr::vector`s).
+ *  - `bl::multi_vector<Ts...>`, a container holding one array per type, all
+ *    of them laid out in a single block. All arrays share the same size and
+ *    capacity, so growing is a single allocation and a single relocation.
+ *
+ * Example usage:
+ * ```cpp
+ * #include "multi-vector.hpp"
+ *
+ * // One allocation instead of two.
+ * bl::block_resource res{{16, sizeof(int),    alignof(int)   },
+ *                        {16, sizeof(double), alignof(double)}};
+ * std::pmr::vector<int>    is(&res);
+ * std::pmr::vector<double> ds(&res);
+ * is.reserve(16);  // Must reserve in the same order as the layouts.
+ * ds.reserve(16);
+ *
+ * // Likewise, but the arrays also grow together.
+ * bl::multi_vector<int, double, char> mv;
+ * mv.push_back(42, 3.14, 'x');
+ * int    *i = mv.data<0>();
+ * double *d = mv.data<1>();
+ * ```
+ */
+
+#ifndef BL_MULTI_VECTOR_HPP
+#define BL_MULTI_VECTOR_HPP
+
+#if defined __GNUC__ && !defined __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wregister"  /* C++17 dropped `register`. */
+#endif
+#include "blayout.h"  /* BL_ALIGNMENT, struct blayout, blcalc(), blnext() */
+#include <algorithm>         /* std::max() */
+#include <cstddef>           /* std::size_t */
+#include <initializer_list>  /* std::initializer_list */
+#include <memory>            /* std::uninitialized_*(), std::destroy() */
+#include <memory_resource>   /* std::pmr::memory_resource */
+#include <new>               /* std::bad_alloc, std::bad_array_new_length */
+#include <tuple>             /* std::tuple, std::get(), std::tuple_element_t */
+#include <type_traits>       /* std::is_nothrow_move_constructible_v */
+#include <utility>           /* std::index_sequence, std::forward(), ... */
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>              /* std::span */
+#define BL_MV_SPAN 1
+#endif
+
+namespace bl {
+
+/*
+ * A monotonic resource over one `blcalc()`-sized block. Allocations are
+ * served from the block in a `blnext()` manner, so if they are made in the
+ * order of (and no larger than) the layouts passed at construction, they all
+ * fit. Anything else goes to `upstream`. Deallocation is a no-op for memory
+ * inside the block, which is released as a whole on destruction.
+ */
+class block_resource : public std::pmr::memory_resource {
+public:
+	explicit block_resource(std::initializer_list<blayout> lays,
+	                        std::pmr::memory_resource *upstream =
+	                            std::pmr::get_default_resource())
+		: upstream_(upstream)
+	{
+		if (lays.size() == 0)
+			return;
+
+		size_ = blcalc(BL_ALIGNMENT, 0, lays.size(), lays.begin(), 0);
+		if (size_ == 0)
+			throw std::bad_array_new_length();
+
+		block_ = upstream_->allocate(size_, BL_ALIGNMENT);
+		cur_ = block_;
+	}
+
+	block_resource(const block_resource &) = delete;
+	block_resource &operator=(const block_resource &) = delete;
+
+	~block_resource() override
+	{
+		if (block_ != nullptr)
+			upstream_->deallocate(block_, size_, BL_ALIGNMENT);
+	}
+
+	void *data() const noexcept { return block_; }
+	std::size_t size() const noexcept { return size_; }
+	std::pmr::memory_resource *upstream() const noexcept { return upstream_; }
+
+private:
+	void *do_allocate(std::size_t bytes, std::size_t align) override
+	{
+		if (cur_ != nullptr && bytes > 0) {
+			char *p = static_cast<char *>(blnext(cur_, 0, align));
+			char *end = static_cast<char *>(block_) + size_;
+			if (p <= end && bytes <= static_cast<std::size_t>(end - p)) {
+				cur_ = p + bytes;
+				return p;
+			}
+		}
+		return upstream_->allocate(bytes, align);
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t align) override
+	{
+		char *begin = static_cast<char *>(block_);
+		char *q = static_cast<char *>(p);
+		if (block_ == nullptr || q < begin || q >= begin + size_)
+			upstream_->deallocate(p, bytes, align);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other)
+		const noexcept override
+	{
+		return this == &other;
+	}
+
+	std::pmr::memory_resource *upstream_;
+	void *block_ = nullptr;
+	void *cur_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+/*
+ * Structure of arrays in a single block. Element `i` consists of
+ * `data<0>()[i]`, `data<1>()[i]` and so on. Memory comes from `resource`,
+ * which defaults to `std::pmr::get_default_resource()`.
+ */
+template <class... Ts>
+class multi_vector {
+	static_assert(sizeof...(Ts) > 0, "need at least one type");
+
+	using pointers = std::tuple<Ts *...>;
+	using indices = std::index_sequence_for<Ts...>;
+
+	static constexpr std::size_t alignment =
+		std::max({static_cast<std::size_t>(BL_ALIGNMENT), alignof(Ts)...});
+	static constexpr bool nothrow_relocate =
+		(std::is_nothrow_move_constructible_v<Ts> && ...);
+
+public:
+	template <std::size_t I>
+	using value_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+	multi_vector() noexcept : multi_vector(std::pmr::get_default_resource()) {}
+
+	explicit multi_vector(std::pmr::memory_resource *resource) noexcept
+		: res_(resource) {}
+
+	multi_vector(const multi_vector &other)
+		: res_(other.res_)
+	{
+		if (other.size_ == 0)
+			return;
+
+		multi_vector tmp(res_);
+		tmp.allocate(other.size_);
+		tmp.copy_from(other.ptrs_, other.size_, indices{});
+		swap(tmp);
+	}
+
+	multi_vector(multi_vector &&other) noexcept
+		: res_(other.res_), block_(other.block_), bytes_(other.bytes_),
+		  size_(other.size_), cap_(other.cap_), ptrs_(other.ptrs_)
+	{
+		other.block_ = nullptr;
+		other.bytes_ = other.size_ = other.cap_ = 0;
+	}
+
+	multi_vector &operator=(multi_vector other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~multi_vector()
+	{
+		clear();
+		deallocate();
+	}
+
+	void swap(multi_vector &other) noexcept
+	{
+		std::swap(res_, other.res_);
+		std::swap(block_, other.block_);
+		std::swap(bytes_, other.bytes_);
+		std::swap(size_, other.size_);
+		std::swap(cap_, other.cap_);
+		std::swap(ptrs_, other.ptrs_);
+	}
+
+	std::size_t size() const noexcept { return size_; }
+	std::size_t capacity() const noexcept { return cap_; }
+	bool empty() const noexcept { return size_ == 0; }
+
+	/* Bytes taken by the single block backing all arrays. */
+	std::size_t bytes() const noexcept { return bytes_; }
+
+	std::pmr::memory_resource *resource() const noexcept { return res_; }
+
+	template <std::size_t I>
+	value_type<I> *data() noexcept { return std::get<I>(ptrs_); }
+
+	template <std::size_t I>
+	const value_type<I> *data() const noexcept { return std::get<I>(ptrs_); }
+
+#ifdef BL_MV_SPAN
+	template <std::size_t I>
+	std::span<value_type<I>> span() noexcept
+	{
+		return {std::get<I>(ptrs_), size_};
+	}
+
+	template <std::size_t I>
+	std::span<const value_type<I>> span() const noexcept
+	{
+		return {std::get<I>(ptrs_), size_};
+	}
+#endif
+
+	std::tuple<Ts &...> operator[](std::size_t i) noexcept
+	{
+		return at(i, indices{});
+	}
+
+	void reserve(std::size_t n)
+	{
+		if (n > cap_)
+			reallocate(n);
+	}
+
+	template <class... Us>
+	void push_back(Us &&...us)
+	{
+		static_assert(sizeof...(Us) == sizeof...(Ts),
+		              "need exactly one value per array");
+		if (size_ == cap_)
+			reallocate(cap_ < 4 ? 4 : cap_ + cap_ / 2);
+
+		construct(size_, indices{}, std::forward<Us>(us)...);
+		++size_;
+	}
+
+	void pop_back() noexcept
+	{
+		--size_;
+		destroy(size_, size_ + 1, indices{});
+	}
+
+	void clear() noexcept
+	{
+		destroy(0, size_, indices{});
+		size_ = 0;
+	}
+
+	void shrink_to_fit()
+	{
+		if (size_ == 0) {
+			deallocate();
+		} else if (size_ < cap_) {
+			reallocate(size_);
+		}
+	}
+
+private:
+	void allocate(std::size_t n)
+	{
+		const blayout lays[] = {{n, sizeof(Ts), alignof(Ts)}...};
+		std::size_t bytes = blcalc(alignment, 0, sizeof...(Ts), lays, 0);
+		if (bytes == 0)
+			throw std::bad_array_new_length();
+
+		block_ = res_->allocate(bytes, alignment);
+		bytes_ = bytes;
+		cap_ = n;
+		ptrs_ = carve(block_, n, indices{});
+	}
+
+	void deallocate() noexcept
+	{
+		if (block_ != nullptr)
+			res_->deallocate(block_, bytes_, alignment);
+		block_ = nullptr;
+		bytes_ = cap_ = 0;
+		ptrs_ = pointers{};
+	}
+
+	/* One allocation, one relocation of every array. */
+	void reallocate(std::size_t n)
+	{
+		multi_vector tmp(res_);
+		tmp.allocate(n);
+		if constexpr (nothrow_relocate) {
+			tmp.move_from(ptrs_, size_, indices{});
+		} else {
+			tmp.copy_from(ptrs_, size_, indices{});
+		}
+		swap(tmp);
+	}
+
+	template <std::size_t... I>
+	static pointers carve(void *blk, std::size_t n, std::index_sequence<I...>)
+	{
+		pointers r;
+		void *p = blk;
+		std::size_t prev_size = 0;
+		((p = blnext(p, prev_size, alignof(Ts)),
+		  std::get<I>(r) = static_cast<Ts *>(p),
+		  prev_size = n * sizeof(Ts)), ...);
+		return r;
+	}
+
+	template <std::size_t... I>
+	std::tuple<Ts &...> at(std::size_t i, std::index_sequence<I...>) noexcept
+	{
+		return {std::get<I>(ptrs_)[i]...};
+	}
+
+	/* Strong guarantee: on failure, whatever was constructed is destroyed. */
+	template <std::size_t... I, class... Us>
+	void construct(std::size_t i, std::index_sequence<I...>, Us &&...us)
+	{
+		std::size_t done = 0;
+		try {
+			((::new (static_cast<void *>(std::get<I>(ptrs_) + i))
+			      Ts(std::forward<Us>(us)), ++done), ...);
+		} catch (...) {
+			((I < done ? std::get<I>(ptrs_)[i].~Ts() : void()), ...);
+			throw;
+		}
+	}
+
+	template <std::size_t... I>
+	void destroy(std::size_t first, std::size_t last,
+	             std::index_sequence<I...>) noexcept
+	{
+		(std::destroy(std::get<I>(ptrs_) + first,
+		              std::get<I>(ptrs_) + last), ...);
+	}
+
+	template <std::size_t... I>
+	void move_from(const pointers &src, std::size_t n,
+	               std::index_sequence<I...>) noexcept
+	{
+		(std::uninitialized_move_n(std::get<I>(src), n,
+		                           std::get<I>(ptrs_)), ...);
+		size_ = n;
+	}
+
+	template <std::size_t... I>
+	void copy_from(const pointers &src, std::size_t n,
+	               std::index_sequence<I...>)
+	{
+		std::size_t done = 0;
+		try {
+			(((void)std::uninitialized_copy_n(std::get<I>(src), n,
+			                                  std::get<I>(ptrs_)),
+			  ++done), ...);
+		} catch (...) {
+			((I < done ? (void)std::destroy_n(std::get<I>(ptrs_), n)
+			           : void()), ...);
+			throw;
+		}
+		size_ = n;
+	}
+
+	std::pmr::memory_resource *res_;
+	void *block_ = nullptr;
+	std::size_t bytes_ = 0;
+	std::size_t size_ = 0;
+	std::size_t cap_ = 0;
+	pointers ptrs_{};
+};
+
+template <class... Ts>
+void swap(multi_vector<Ts...> &a, multi_vector<Ts...> &b) noexcept
+{
+	a.swap(b);
+}
+
+}  /* namespace bl */
+
+#undef BL_MV_SPAN
+#if defined __GNUC__ && !defined __clang__
+#pragma GCC diagnostic pop
+#endif
+#endif  /* BL_MULTI_VECTOR_HPP */
@@ -0,0 +1,616 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Parallel iteration over the elements of every region of a laid-out block,
+ * on a pool of POSIX threads that balance the work by stealing it from each
+ * other.
+ *
+ * The regions, found by walking the layouts with `blnext()`, are handed out
+ * whole, one at a time. A thread that gets a range of elements halves it
+ * until it's no larger than `PAR_GRAIN` bytes, keeps the lower halves and
+ * pushes the upper ones onto its own Chase-Lev deque, and then works through
+ * its deque from the bottom: the smallest, most recently split, ranges,
+ * whose memory is still in its cache. A thread with nothing left to do
+ * steals from the top of some other thread's deque, where the largest
+ * ranges are, so that a steal is rare and pays off. Ranges are cut where
+ * cache lines start, so that two threads only ever write to the same line
+ * if an element straddles it.
+ *
+ * Callbacks see elements the way `blnext()` and `blsizeof()` lay them out:
+ * element `i` of region `r` is `blmemb(ptr, lays[r].size, i)`, where `ptr` is
+ * the first element of the region. They are called concurrently, in no
+ * particular order, and must not call back into the pool. The calling
+ * thread counts as worker 0.
+ *
+ * Requires POSIX (`_POSIX_C_SOURCE >= 200112L`) and GCC or Clang `__atomic`
+ * builtins. Implemented as a "header library", like `aligned-malloc.h`.
+ * Example usage:
+ * ```c
+ * #define PAR_API static    // Fine if used in a single translation unit.
+ * #define PAR_IMPL          // Include the implementation here.
+ * #include "par-for.h"      // struct par_pool, par_*()
+ *
+ * static void scale(void *ctx, size_t region, void *ptr, size_t first,
+ *                   size_t count)
+ * {
+ *     float *f = (float *)ptr + first;
+ *     for (size_t i = 0; i < count; ++i)
+ *         f[i] *= *(float *)ctx;
+ * }
+ *
+ * struct par_pool pool;
+ * if (par_pool_init(&pool, 0) != 0)
+ *     return 1;
+ *
+ * float k = 2.0f;
+ * par_for_range(&pool, block, n, lays, scale, &k);  // Every region is float.
+ * par_pool_destroy(&pool);
+ * ```
+ */
+
+#ifndef PAR_H
+#define PAR_H
+
+#include "blayout.h"  /* struct blayout */
+#include <pthread.h>  /* pthread_t, pthread_mutex_t, pthread_cond_t */
+#include <stddef.h>   /* size_t */
+
+#ifndef PAR_API
+#	define PAR_API
+#endif
+
+/* Ranges larger than this many bytes are split. */
+#ifndef PAR_GRAIN
+#	define PAR_GRAIN (16 * 1024)
+#endif
+
+#ifndef PAR_LINE
+#	define PAR_LINE 64
+#endif
+
+/* Ranges per deque; a power of 2. A range that doesn't fit isn't split. */
+#ifndef PAR_DEQUE
+#	define PAR_DEQUE 128
+#endif
+
+struct par_deque;
+struct par_job;
+
+struct par_pool {
+	pthread_t *tids;
+	struct par_deque *deques;  /* One per thread. */
+	unsigned nthreads;         /* Including the caller. */
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned long gen;
+	unsigned pending;
+	int stop;
+	struct par_job *job;
+};
+
+/* Called with element `i` of region `region`, at `elem`. */
+typedef void par_elem_fn(void *ctx, size_t region, void *elem, size_t i);
+
+/*
+ * Called with `count` consecutive elements, starting with element `first`, of
+ * region `region`, whose first element is at `ptr`.
+ */
+typedef void par_range_fn(void *ctx, size_t region, void *ptr, size_t first,
+                          size_t count);
+
+/* Same as `par_range_fn`, folding the elements into the worker's `acc`. */
+typedef void par_reduce_fn(void *ctx, void *acc, size_t region, void *ptr,
+                           size_t first, size_t count);
+
+/* Folds `other` into `acc`. */
+typedef void par_combine_fn(void *ctx, void *acc, const void *other);
+
+/* `nthreads` includes the caller; 0 means one per online CPU. */
+PAR_API int par_pool_init(struct par_pool *p, unsigned nthreads);
+PAR_API void par_pool_destroy(struct par_pool *p);
+
+/* All return 0 on success or -1 with `errno` set. */
+PAR_API int par_for_each(struct par_pool *p, void *block, size_t n,
+                         const struct blayout *lays, par_elem_fn *fn,
+                         void *ctx);
+
+PAR_API int par_for_range(struct par_pool *p, void *block, size_t n,
+                          const struct blayout *lays, par_range_fn *fn,
+                          void *ctx);
+
+/*
+ * Every worker starts from a copy of the `size` bytes at `acc`, which must be
+ * the identity of `combine` and may be aligned to at most `PAR_LINE`. The
+ * copies are then combined into `acc`, in worker order, but which elements
+ * each copy saw varies from call to call.
+ */
+PAR_API int par_reduce(struct par_pool *p, void *block, size_t n,
+                       const struct blayout *lays, par_reduce_fn *fn,
+                       par_combine_fn *combine, void *ctx, void *acc,
+                       size_t size);
+
+#endif  /* PAR_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef PAR_IMPL
+
+/* blcalc(), blnext(), blsizeof(), blmemb() */
+#include "blayout.h"
+#include <errno.h>    /* errno, EINVAL, ENOMEM */
+#include <sched.h>    /* sched_yield() */
+#include <stdint.h>   /* uintptr_t */
+#include <stdlib.h>   /* malloc(), free(), posix_memalign() */
+#include <string.h>   /* memcpy() */
+#include <unistd.h>   /* sysconf() */
+
+#if !defined __GNUC__
+#	error "`par-for.h` requires GCC or Clang `__atomic` builtins"
+#endif
+
+#define PAR_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+enum par_op {
+	PAR_OP_EACH,
+	PAR_OP_RANGE,
+	PAR_OP_REDUCE
+};
+
+/* Elements `[first, last)` of region `region`. */
+struct par_task {
+	size_t region;
+	size_t first;
+	size_t last;
+};
+
+/*
+ * Chase-Lev, as in "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (Lê et al., 2013), without growing: the owner only splits what it
+ * took last, so the ranges in a deque halve from top to bottom and there are
+ * never many of them. Thieves may read a slot while the owner rewrites it,
+ * hence the atomic accesses; they then lose the race for `top`.
+ */
+struct par_deque {
+	ptrdiff_t top;     /* Where thieves take from. */
+	ptrdiff_t bottom   /* Where the owner pushes and takes. */
+		__attribute__((__aligned__(PAR_LINE)));
+	struct par_task tasks[PAR_DEQUE];
+} __attribute__((__aligned__(PAR_LINE)));
+
+struct par_region {
+	char *ptr;
+	size_t size;  /* Of an element. */
+	size_t nmemb;
+};
+
+struct par_job {
+	enum par_op op;
+	par_elem_fn *each;
+	par_range_fn *range;
+	par_reduce_fn *reduce;
+	void *ctx;
+	char *accs;        /* One per worker, `stride` bytes apart. */
+	size_t stride;
+	struct par_region *regs;
+	size_t nregs;
+	size_t next;       /* Next region to hand out. */
+	size_t left;       /* Elements not done yet. */
+};
+
+static void par_store(struct par_task *dst, const struct par_task *t)
+{
+	__atomic_store_n(&dst->region, t->region, __ATOMIC_RELAXED);
+	__atomic_store_n(&dst->first, t->first, __ATOMIC_RELAXED);
+	__atomic_store_n(&dst->last, t->last, __ATOMIC_RELAXED);
+}
+
+static void par_load(struct par_task *t, struct par_task *src)
+{
+	t->region = __atomic_load_n(&src->region, __ATOMIC_RELAXED);
+	t->first = __atomic_load_n(&src->first, __ATOMIC_RELAXED);
+	t->last = __atomic_load_n(&src->last, __ATOMIC_RELAXED);
+}
+
+/* By the owner. Returns 0 if full. */
+static int par_push(struct par_deque *q, const struct par_task *t)
+{
+	ptrdiff_t b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED);
+	ptrdiff_t top = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+	if (PAR_UNLIKELY(b - top >= PAR_DEQUE))
+		return 0;
+
+	par_store(&q->tasks[b & (PAR_DEQUE - 1)], t);
+	__atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/* By the owner, from the bottom. Returns 0 if empty. */
+static int par_take(struct par_deque *q, struct par_task *t)
+{
+	ptrdiff_t b = __atomic_load_n(&q->bottom, __ATOMIC_RELAXED) - 1;
+	ptrdiff_t top;
+	int ok = 1;
+	__atomic_store_n(&q->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&q->top, __ATOMIC_RELAXED);
+	if (top > b) {
+		__atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	par_load(t, &q->tasks[b & (PAR_DEQUE - 1)]);
+	if (top == b) {
+		/* The last one; thieves may be after it too. */
+		ok = __atomic_compare_exchange_n(&q->top, &top, top + 1, 0,
+		                                 __ATOMIC_SEQ_CST,
+		                                 __ATOMIC_RELAXED);
+		__atomic_store_n(&q->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return ok;
+}
+
+/* By anyone else, from the top. Returns 0 if empty or if another won. */
+static int par_steal(struct par_deque *q, struct par_task *t)
+{
+	ptrdiff_t top = __atomic_load_n(&q->top, __ATOMIC_ACQUIRE);
+	ptrdiff_t b;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&q->bottom, __ATOMIC_ACQUIRE);
+	if (top >= b)
+		return 0;
+
+	par_load(t, &q->tasks[top & (PAR_DEQUE - 1)]);
+	return __atomic_compare_exchange_n(&q->top, &top, top + 1, 0,
+	                                   __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+/*
+ * Where to split `t`: the first element starting on or after the cache line
+ * that holds its middle. Returns 0 if `t` is small enough as it is.
+ */
+static size_t par_split(const struct par_job *j, const struct par_task *t)
+{
+	const struct par_region *reg = &j->regs[t->region];
+	const uintptr_t base = (uintptr_t)reg->ptr;
+	const size_t n = t->last - t->first;
+	uintptr_t mid;
+	size_t m;
+	if (n < 2 || n * reg->size <= PAR_GRAIN)
+		return 0;
+
+	mid = (base + (t->first + n / 2) * reg->size)
+	    & ~(uintptr_t)(PAR_LINE - 1);
+	if (mid <= base + t->first * reg->size)
+		return 0;
+
+	m = (mid - base + reg->size - 1) / reg->size;
+	return m < t->last ? m : 0;
+}
+
+static void par_leaf(const struct par_job *j, unsigned id,
+                     const struct par_task *t)
+{
+	const struct par_region *reg = &j->regs[t->region];
+	switch (j->op) {
+	case PAR_OP_EACH: {
+		size_t i;
+		for (i = t->first; i < t->last; ++i)
+			j->each(j->ctx, t->region,
+			        blmemb(reg->ptr, reg->size, (ptrdiff_t)i), i);
+		break;
+	}
+	case PAR_OP_RANGE:
+		j->range(j->ctx, t->region, reg->ptr, t->first, t->last - t->first);
+		break;
+	case PAR_OP_REDUCE:
+		j->reduce(j->ctx, j->accs + id * j->stride, t->region, reg->ptr,
+		          t->first, t->last - t->first);
+		break;
+	}
+}
+
+/* Splits `t` down to size, keeping the lower halves, and runs what's left. */
+static void par_run_task(struct par_job *j, struct par_deque *q, unsigned id,
+                         struct par_task *t)
+{
+	for (;;) {
+		struct par_task upper;
+		size_t mid = par_split(j, t);
+		if (mid == 0)
+			break;
+
+		upper.region = t->region;
+		upper.first = mid;
+		upper.last = t->last;
+		if (PAR_UNLIKELY(!par_push(q, &upper)))
+			break;
+
+		t->last = mid;
+	}
+	par_leaf(j, id, t);
+	__atomic_sub_fetch(&j->left, t->last - t->first, __ATOMIC_RELEASE);
+}
+
+/* Tries every other deque once, starting from a random one. */
+static int par_steal_any(struct par_pool *p, unsigned id, unsigned long *rng,
+                         struct par_task *t)
+{
+	unsigned i, v;
+	if (p->nthreads < 2)
+		return 0;
+
+	*rng ^= *rng << 13;
+	*rng ^= *rng >> 7;
+	*rng ^= *rng << 17;
+	v = (unsigned)(*rng % p->nthreads);
+	for (i = 0; i < p->nthreads; ++i, v = v + 1 == p->nthreads ? 0 : v + 1) {
+		if (v != id && par_steal(&p->deques[v], t))
+			return 1;
+	}
+	return 0;
+}
+
+static void par_work(struct par_pool *p, struct par_job *j, unsigned id)
+{
+	struct par_deque *q = &p->deques[id];
+	unsigned long rng = 0x9e3779b97f4a7c15u * (id + 1ul) | 1;
+	while (__atomic_load_n(&j->left, __ATOMIC_ACQUIRE) != 0) {
+		struct par_task t;
+		size_t r;
+		if (par_take(q, &t)) {
+			par_run_task(j, q, id, &t);
+			continue;
+		}
+
+		r = __atomic_load_n(&j->next, __ATOMIC_RELAXED);
+		if (r < j->nregs) {
+			r = __atomic_fetch_add(&j->next, 1, __ATOMIC_RELAXED);
+			if (r < j->nregs) {
+				t.region = r;
+				t.first = 0;
+				t.last = j->regs[r].nmemb;
+				par_run_task(j, q, id, &t);
+				continue;
+			}
+		}
+
+		if (par_steal_any(p, id, &rng, &t))
+			par_run_task(j, q, id, &t);
+		else
+			sched_yield();  /* Let whoever holds the rest run. */
+	}
+}
+
+struct par_worker {
+	struct par_pool *pool;
+	unsigned id;
+};
+
+static void *par_thread(void *arg)
+{
+	struct par_pool *p = ((struct par_worker *)arg)->pool;
+	unsigned id = ((struct par_worker *)arg)->id;
+	unsigned long seen = 0;
+	free(arg);
+	for (;;) {
+		struct par_job *j;
+		pthread_mutex_lock(&p->lock);
+		while (p->gen == seen && !p->stop)
+			pthread_cond_wait(&p->start, &p->lock);
+		if (p->stop) {
+			pthread_mutex_unlock(&p->lock);
+			return NULL;
+		}
+		seen = p->gen;
+		j = p->job;
+		pthread_mutex_unlock(&p->lock);
+
+		par_work(p, j, id);
+
+		pthread_mutex_lock(&p->lock);
+		if (--p->pending == 0)
+			pthread_cond_signal(&p->done);
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+PAR_API int par_pool_init(struct par_pool *p, unsigned nthreads)
+{
+	void *deques;
+	unsigned i;
+	int err;
+	if (nthreads == 0) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpu > 0 ? (unsigned)ncpu : 1;
+	}
+
+	p->tids = malloc(nthreads * sizeof *p->tids);
+	if (PAR_UNLIKELY(p->tids == NULL))
+		return -1;
+
+	err = posix_memalign(&deques, PAR_LINE, nthreads * sizeof *p->deques);
+	if (PAR_UNLIKELY(err != 0)) {
+		free(p->tids);
+		errno = err;
+		return -1;
+	}
+	p->deques = deques;
+	for (i = 0; i < nthreads; ++i) {
+		p->deques[i].top = 0;
+		p->deques[i].bottom = 0;
+	}
+
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->start, NULL);
+	pthread_cond_init(&p->done, NULL);
+	p->nthreads = nthreads;
+	p->gen = 0;
+	p->pending = 0;
+	p->stop = 0;
+	p->job = NULL;
+
+	for (i = 1; i < nthreads; ++i) {
+		struct par_worker *w = malloc(sizeof *w);
+		if (PAR_UNLIKELY(w == NULL)) {
+			err = ENOMEM;
+			goto error;
+		}
+
+		w->pool = p;
+		w->id = i;
+		err = pthread_create(&p->tids[i], NULL, par_thread, w);
+		if (PAR_UNLIKELY(err != 0)) {
+			free(w);
+			goto error;
+		}
+	}
+	return 0;
+
+error:
+	p->nthreads = i;
+	par_pool_destroy(p);
+	errno = err;
+	return -1;
+}
+
+PAR_API void par_pool_destroy(struct par_pool *p)
+{
+	unsigned i;
+	pthread_mutex_lock(&p->lock);
+	p->stop = 1;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+	for (i = 1; i < p->nthreads; ++i)
+		pthread_join(p->tids[i], NULL);
+
+	pthread_cond_destroy(&p->done);
+	pthread_cond_destroy(&p->start);
+	pthread_mutex_destroy(&p->lock);
+	free(p->deques);
+	free(p->tids);
+	p->deques = NULL;
+	p->tids = NULL;
+}
+
+static int par_run(struct par_pool *p, struct par_job *j, char *block,
+                   size_t n, const struct blayout *lays)
+{
+	size_t i;
+	char *d = block;
+	size_t prev_size = 0;
+	j->left = 0;
+	if (n == 0)
+		return 0;
+
+	j->regs = malloc(n * sizeof *j->regs);
+	if (PAR_UNLIKELY(j->regs == NULL))
+		return -1;
+
+	for (i = 0; i < n; ++i) {
+		d = blnext(d, prev_size, lays[i].align);
+		prev_size = blsizeof(&lays[i]);
+		j->regs[i].ptr = d;
+		j->regs[i].size = lays[i].size;
+		j->regs[i].nmemb = lays[i].nmemb;
+		j->left += lays[i].nmemb;
+	}
+	j->nregs = n;
+	j->next = 0;
+
+	pthread_mutex_lock(&p->lock);
+	p->job = j;
+	p->pending = p->nthreads - 1;
+	++p->gen;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+
+	par_work(p, j, 0);
+
+	pthread_mutex_lock(&p->lock);
+	while (p->pending != 0)
+		pthread_cond_wait(&p->done, &p->lock);
+	p->job = NULL;
+	pthread_mutex_unlock(&p->lock);
+
+	free(j->regs);
+	return 0;
+}
+
+PAR_API int par_for_each(struct par_pool *p, void *block, size_t n,
+                         const struct blayout *lays, par_elem_fn *fn,
+                         void *ctx)
+{
+	struct par_job j;
+	j.op = PAR_OP_EACH;
+	j.each = fn;
+	j.ctx = ctx;
+	return par_run(p, &j, block, n, lays);
+}
+
+PAR_API int par_for_range(struct par_pool *p, void *block, size_t n,
+                          const struct blayout *lays, par_range_fn *fn,
+                          void *ctx)
+{
+	struct par_job j;
+	j.op = PAR_OP_RANGE;
+	j.range = fn;
+	j.ctx = ctx;
+	return par_run(p, &j, block, n, lays);
+}
+
+PAR_API int par_reduce(struct par_pool *p, void *block, size_t n,
+                       const struct blayout *lays, par_reduce_fn *fn,
+                       par_combine_fn *combine, void *ctx, void *acc,
+                       size_t size)
+{
+	struct par_job j;
+	struct blayout l;
+	void *accs;
+	unsigned i;
+	int err;
+	if (PAR_UNLIKELY(size == 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* One accumulator per worker, on cache lines of its own. */
+	l.nmemb = p->nthreads;
+	l.size = (size + PAR_LINE - 1) & ~(size_t)(PAR_LINE - 1);
+	l.align = PAR_LINE;
+	if (PAR_UNLIKELY(l.size < size || blcalc(PAR_LINE, 0, 1, &l, 0) == 0)) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	err = posix_memalign(&accs, PAR_LINE, blsizeof(&l));
+	if (PAR_UNLIKELY(err != 0)) {
+		errno = err;
+		return -1;
+	}
+	for (i = 0; i < p->nthreads; ++i)
+		memcpy((char *)accs + i * l.size, acc, size);
+
+	j.op = PAR_OP_REDUCE;
+	j.reduce = fn;
+	j.ctx = ctx;
+	j.accs = accs;
+	j.stride = l.size;
+	if (PAR_UNLIKELY(par_run(p, &j, block, n, lays) != 0)) {
+		free(accs);
+		return -1;
+	}
+
+	for (i = 0; i < p->nthreads; ++i)
+		combine(ctx, acc, (char *)accs + i * l.size);
+	free(accs);
+	return 0;
+}
+
+#undef PAR_UNLIKELY
+
+#undef PAR_IMPL
+#endif  /* PAR_IMPL */
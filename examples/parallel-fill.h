@@ -0,0 +1,386 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Parallel `memset()`/`memcpy()`/initialization of the regions of a laid-out
+ * block, on a small pool of POSIX threads.
+ *
+ * The regions, found by walking the layouts with `blnext()`, are cut at page
+ * boundaries, so `pf_fill()` and `pf_copy()` never have two workers write to
+ * the same page. `pf_init()` can't split an element, so one that straddles a
+ * boundary is written whole by the worker whose part holds its first byte,
+ * tail included, on the first page of the next part. With `PF_FIRST_TOUCH`,
+ * worker `i` of `n` gets the `i`th contiguous `1/n` of the pages and
+ * (straddling elements aside) nothing else, so the pages of a fresh block are
+ * faulted in (and, under a first-touch NUMA policy, placed) by the thread
+ * that will presumably use them. Otherwise, chunks of `PF_CHUNK` bytes are
+ * handed out dynamically, which balances better.
+ *
+ * The calling thread counts as worker 0. Padding between regions is left
+ * untouched.
+ *
+ * Requires POSIX (`_POSIX_C_SOURCE >= 200809L`). Implemented as a "header
+ * library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define PF_API static       // Fine if used in a single translation unit.
+ * #define PF_IMPL             // Include the implementation here.
+ * #include "parallel-fill.h"  // struct pf_pool, pf_*()
+ *
+ * struct pf_pool pool;
+ * if (pf_pool_init(&pool, 16) != 0)
+ *     return 1;
+ *
+ * void *block = malloc(size);  // `size` from `blcalc(BL_ALIGNMENT, 0, n, lays, 0)`.
+ * pf_fill(&pool, block, n, lays, 0, PF_FIRST_TOUCH);
+ * pf_pool_destroy(&pool);
+ * ```
+ */
+
+#ifndef PF_H
+#define PF_H
+
+#include "blayout.h"  /* struct blayout */
+#include <pthread.h>  /* pthread_t, pthread_mutex_t, pthread_cond_t */
+#include <stddef.h>   /* size_t */
+
+#ifndef PF_API
+#	define PF_API
+#endif
+
+/* Bytes per dynamically scheduled chunk; rounded up to whole pages. */
+#ifndef PF_CHUNK
+#	define PF_CHUNK (256 * 1024)
+#endif
+
+enum pf_policy {
+	PF_DYNAMIC,
+	PF_FIRST_TOUCH
+};
+
+struct pf_job;
+
+struct pf_pool {
+	pthread_t *tids;
+	unsigned nthreads;  /* Including the caller. */
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	unsigned long gen;
+	unsigned pending;
+	int stop;
+	struct pf_job *job;
+};
+
+/*
+ * Called with `count` consecutive elements, starting with element `first`, of
+ * region `region`, whose first element is at `ptr`.
+ */
+typedef void pf_init_fn(void *ctx, size_t region, void *ptr, size_t first,
+                        size_t count);
+
+/* `nthreads` includes the caller; 0 means one per online CPU. */
+PF_API int pf_pool_init(struct pf_pool *p, unsigned nthreads);
+PF_API void pf_pool_destroy(struct pf_pool *p);
+
+/* All return 0 on success or -1 with `errno` set. */
+PF_API int pf_fill(struct pf_pool *p, void *block, size_t n,
+                   const struct blayout *lays, int byte,
+                   enum pf_policy policy);
+
+/* `dst` and `src` must be laid out identically (same `blcalc()` alignment). */
+PF_API int pf_copy(struct pf_pool *p, void *dst, const void *src, size_t n,
+                   const struct blayout *lays, enum pf_policy policy);
+
+PF_API int pf_init(struct pf_pool *p, void *block, size_t n,
+                   const struct blayout *lays, pf_init_fn *fn, void *ctx,
+                   enum pf_policy policy);
+
+#endif  /* PF_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef PF_IMPL
+
+/* blnext(), blsizeof() */
+#include "blayout.h"
+#include <errno.h>    /* errno, ENOMEM */
+#include <stdint.h>   /* uintptr_t */
+#include <stdlib.h>   /* malloc(), free() */
+#include <string.h>   /* memset(), memcpy() */
+#include <unistd.h>   /* sysconf() */
+
+#ifdef __GNUC__
+#	define PF_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#	define PF_UNLIKELY(x) (x)
+#endif
+
+enum pf_op {
+	PF_OP_FILL,
+	PF_OP_COPY,
+	PF_OP_INIT
+};
+
+struct pf_region {
+	char *dst;
+	const char *src;
+	size_t size;
+	size_t esize;
+};
+
+struct pf_job {
+	enum pf_op op;
+	enum pf_policy policy;
+	int byte;
+	pf_init_fn *fn;
+	void *ctx;
+	struct pf_region *regs;
+	size_t nregs;
+	uintptr_t base;   /* Page-aligned, at or below the first region. */
+	uintptr_t end;    /* One past the last region. */
+	size_t page;
+	size_t chunk;     /* A multiple of `page`. */
+	size_t nchunks;
+	size_t next;      /* Next dynamic chunk. */
+};
+
+/* Does whatever `j` asks for on the part of every region inside `[a, b)`. */
+static void pf_range(const struct pf_job *j, uintptr_t a, uintptr_t b)
+{
+	size_t r;
+	for (r = 0; r < j->nregs; ++r) {
+		const struct pf_region *reg = &j->regs[r];
+		uintptr_t rs = (uintptr_t)reg->dst;
+		uintptr_t re = rs + reg->size;
+		uintptr_t s = a > rs ? a : rs;
+		uintptr_t e = b < re ? b : re;
+		if (s >= e)
+			continue;
+
+		switch (j->op) {
+		case PF_OP_FILL:
+			memset(reg->dst + (s - rs), j->byte, e - s);
+			break;
+		case PF_OP_COPY:
+			memcpy(reg->dst + (s - rs), reg->src + (s - rs), e - s);
+			break;
+		case PF_OP_INIT: {
+			/* An element belongs to the chunk holding its first byte. */
+			size_t first = (s - rs + reg->esize - 1) / reg->esize;
+			size_t last = (e - rs + reg->esize - 1) / reg->esize;
+			if (first < last)
+				j->fn(j->ctx, r, reg->dst, first, last - first);
+			break;
+		}
+		}
+	}
+}
+
+static void pf_work(struct pf_job *j, unsigned id, unsigned nthreads)
+{
+	if (j->policy == PF_FIRST_TOUCH) {
+		size_t npages = (size_t)(j->end - j->base + j->page - 1) / j->page;
+		size_t p0 = npages / nthreads * id + npages % nthreads * id / nthreads;
+		size_t p1 = npages / nthreads * (id + 1)
+		          + npages % nthreads * (id + 1) / nthreads;
+		if (p0 < p1)
+			pf_range(j, j->base + p0 * j->page, j->base + p1 * j->page);
+		return;
+	}
+
+	for (;;) {
+		size_t c = __atomic_fetch_add(&j->next, 1, __ATOMIC_RELAXED);
+		if (c >= j->nchunks)
+			return;
+
+		pf_range(j, j->base + c * j->chunk, j->base + (c + 1) * j->chunk);
+	}
+}
+
+struct pf_worker {
+	struct pf_pool *pool;
+	unsigned id;
+};
+
+static void *pf_thread(void *arg)
+{
+	struct pf_pool *p = ((struct pf_worker *)arg)->pool;
+	unsigned id = ((struct pf_worker *)arg)->id;
+	unsigned long seen = 0;
+	free(arg);
+	for (;;) {
+		struct pf_job *j;
+		pthread_mutex_lock(&p->lock);
+		while (p->gen == seen && !p->stop)
+			pthread_cond_wait(&p->start, &p->lock);
+		if (p->stop) {
+			pthread_mutex_unlock(&p->lock);
+			return NULL;
+		}
+		seen = p->gen;
+		j = p->job;
+		pthread_mutex_unlock(&p->lock);
+
+		pf_work(j, id, p->nthreads);
+
+		pthread_mutex_lock(&p->lock);
+		if (--p->pending == 0)
+			pthread_cond_signal(&p->done);
+		pthread_mutex_unlock(&p->lock);
+	}
+}
+
+PF_API int pf_pool_init(struct pf_pool *p, unsigned nthreads)
+{
+	unsigned i;
+	int err;
+	if (nthreads == 0) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpu > 0 ? (unsigned)ncpu : 1;
+	}
+
+	p->tids = malloc(nthreads * sizeof *p->tids);
+	if (PF_UNLIKELY(p->tids == NULL))
+		return -1;
+
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->start, NULL);
+	pthread_cond_init(&p->done, NULL);
+	p->nthreads = nthreads;
+	p->gen = 0;
+	p->pending = 0;
+	p->stop = 0;
+	p->job = NULL;
+
+	for (i = 1; i < nthreads; ++i) {
+		struct pf_worker *w = malloc(sizeof *w);
+		if (PF_UNLIKELY(w == NULL)) {
+			err = ENOMEM;
+			goto error;
+		}
+
+		w->pool = p;
+		w->id = i;
+		err = pthread_create(&p->tids[i], NULL, pf_thread, w);
+		if (PF_UNLIKELY(err != 0)) {
+			free(w);
+			goto error;
+		}
+	}
+	return 0;
+
+error:
+	p->nthreads = i;
+	pf_pool_destroy(p);
+	errno = err;
+	return -1;
+}
+
+PF_API void pf_pool_destroy(struct pf_pool *p)
+{
+	unsigned i;
+	pthread_mutex_lock(&p->lock);
+	p->stop = 1;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+	for (i = 1; i < p->nthreads; ++i)
+		pthread_join(p->tids[i], NULL);
+
+	pthread_cond_destroy(&p->done);
+	pthread_cond_destroy(&p->start);
+	pthread_mutex_destroy(&p->lock);
+	free(p->tids);
+	p->tids = NULL;
+}
+
+static int pf_run(struct pf_pool *p, struct pf_job *j, char *dst,
+                  const char *src, size_t n, const struct blayout *lays)
+{
+	size_t i;
+	char *d = dst;
+	const char *s = src;
+	size_t prev_size = 0;
+	long page = sysconf(_SC_PAGESIZE);
+	if (n == 0)
+		return 0;
+
+	j->regs = malloc(n * sizeof *j->regs);
+	if (PF_UNLIKELY(j->regs == NULL))
+		return -1;
+
+	for (i = 0; i < n; ++i) {
+		d = blnext(d, prev_size, lays[i].align);
+		if (s != NULL)
+			s = blnext((void *)(uintptr_t)s, prev_size, lays[i].align);
+		prev_size = blsizeof(&lays[i]);
+		j->regs[i].dst = d;
+		j->regs[i].src = s;
+		j->regs[i].size = prev_size;
+		j->regs[i].esize = lays[i].size;
+	}
+
+	j->nregs = n;
+	j->page = page > 0 ? (size_t)page : 4096;
+	j->base = (uintptr_t)dst & ~(uintptr_t)(j->page - 1);
+	j->end = (uintptr_t)d + prev_size;
+	j->chunk = (PF_CHUNK + j->page - 1) / j->page * j->page;
+	j->nchunks = (size_t)(j->end - j->base + j->chunk - 1) / j->chunk;
+	j->next = 0;
+
+	pthread_mutex_lock(&p->lock);
+	p->job = j;
+	p->pending = p->nthreads - 1;
+	++p->gen;
+	pthread_cond_broadcast(&p->start);
+	pthread_mutex_unlock(&p->lock);
+
+	pf_work(j, 0, p->nthreads);
+
+	pthread_mutex_lock(&p->lock);
+	while (p->pending != 0)
+		pthread_cond_wait(&p->done, &p->lock);
+	p->job = NULL;
+	pthread_mutex_unlock(&p->lock);
+
+	free(j->regs);
+	return 0;
+}
+
+PF_API int pf_fill(struct pf_pool *p, void *block, size_t n,
+                   const struct blayout *lays, int byte,
+                   enum pf_policy policy)
+{
+	struct pf_job j;
+	j.op = PF_OP_FILL;
+	j.policy = policy;
+	j.byte = byte;
+	return pf_run(p, &j, block, NULL, n, lays);
+}
+
+PF_API int pf_copy(struct pf_pool *p, void *dst, const void *src, size_t n,
+                   const struct blayout *lays, enum pf_policy policy)
+{
+	struct pf_job j;
+	j.op = PF_OP_COPY;
+	j.policy = policy;
+	return pf_run(p, &j, dst, src, n, lays);
+}
+
+PF_API int pf_init(struct pf_pool *p, void *block, size_t n,
+                   const struct blayout *lays, pf_init_fn *fn, void *ctx,
+                   enum pf_policy policy)
+{
+	struct pf_job j;
+	j.op = PF_OP_INIT;
+	j.policy = policy;
+	j.fn = fn;
+	j.ctx = ctx;
+	return pf_run(p, &j, block, NULL, n, lays);
+}
+
+#undef PF_UNLIKELY
+
+#undef PF_IMPL
+#endif  /* PF_IMPL */
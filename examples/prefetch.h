@@ -0,0 +1,132 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Software prefetching for code that walks many blocks sharing one layout
+ * and reads the same region `k` of each.
+ *
+ * Walking `blnext()` from the start of every block to reach region `k` is a
+ * chain of dependent computations, and the load at the end of it usually
+ * misses the cache. Instead:
+ *
+ *  1. `pr_plan()` computes, once, the offset of every region from the start
+ *     of any block aligned to (at least) the largest alignment among the
+ *     layouts. That's exactly what `blnext()` would compute for such a block.
+ *  2. `pr_ahead()` prefetches region `k` of the block `dist` positions ahead
+ *     of the current one, so that by the time it's needed it has arrived.
+ *  3. `pr_gather()` does both in a loop, copying region `k` of `n` blocks
+ *     into one contiguous array.
+ *
+ * Everything is `static inline`. Example usage:
+ * ```c
+ * #include "prefetch.h"  // pr_plan(), pr_ahead(), pr_gather()
+ *
+ * size_t offs[3];
+ * if (pr_plan(offs, BL_ALIGNMENT, 3, lays) != 0)
+ *     return 1;  // Some layout is over-aligned for `BL_ALIGNMENT` blocks.
+ *
+ * for (size_t i = 0; i < n; ++i) {
+ *     pr_ahead(blocks, n, i + 8, offs[2], blsizeof(&lays[2]));
+ *     const float *f = (const float *)((const char *)blocks[i] + offs[2]);
+ *     sum += f[0];
+ * }
+ * ```
+ */
+
+#ifndef PR_H
+#define PR_H
+
+#include "blayout.h"  /* struct blayout, blcalc(), blsizeof() */
+#include <stddef.h>   /* size_t */
+#include <stdint.h>   /* uintptr_t */
+#include <string.h>   /* memcpy() */
+
+#ifndef PR_LINE
+#	define PR_LINE 64
+#endif
+
+/* How many blocks ahead `pr_gather()` prefetches by default. */
+#ifndef PR_DISTANCE
+#	define PR_DISTANCE 8
+#endif
+
+/* At most this many cache lines are prefetched per region. */
+#ifndef PR_MAX_LINES
+#	define PR_MAX_LINES 4
+#endif
+
+#ifdef __GNUC__
+#	define PR_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#elif defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+#	include <xmmintrin.h>  /* _mm_prefetch() */
+#	define PR_PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+#	define PR_PREFETCH(p) ((void)(p))
+#endif
+
+/*
+ * Stores the offset of each of the `n` regions into `offs`. Returns 0 on
+ * success, or -1 if some region is more strictly aligned than `align` (whose
+ * offset would then depend on the block's address) or on overflow. Blocks
+ * must be at least `align`-aligned.
+ */
+static inline int pr_plan(size_t *offs, size_t align, size_t n,
+                          const struct blayout *lays)
+{
+	size_t pos = 0;
+	size_t prev_size = 0;
+	size_t i;
+	if (n == 0 || blcalc(align, 0, n, lays, 0) == 0)
+		return -1;
+
+	for (i = 0; i < n; ++i) {
+		if (lays[i].align > align)
+			return -1;
+
+		/* Same as `blnext()`, relative to an `align`-aligned address. */
+		pos += prev_size;
+		pos += ~(pos - 1) & (lays[i].align - 1);
+		offs[i] = pos;
+		prev_size = blsizeof(&lays[i]);
+	}
+	return 0;
+}
+
+/* Prefetches `bytes` bytes at `off` into `blocks[i]`, if `i < n`. */
+static inline void pr_ahead(const void *const *blocks, size_t n, size_t i,
+                            size_t off, size_t bytes)
+{
+	if (i < n) {
+		uintptr_t p = (uintptr_t)blocks[i] + off;
+		size_t lines = ((p & (PR_LINE - 1)) + bytes + PR_LINE - 1) / PR_LINE;
+		size_t k;
+		if (lines > PR_MAX_LINES)
+			lines = PR_MAX_LINES;
+		for (k = 0; k < lines; ++k)
+			PR_PREFETCH((const void *)(p + k * PR_LINE));
+	}
+}
+
+/*
+ * Copies `size` bytes at offset `off` of each of the `n` blocks into
+ * `dst[i * size]`, prefetching `dist` blocks ahead (`PR_DISTANCE` if 0).
+ */
+static inline void pr_gather(void *dst, const void *const *blocks, size_t n,
+                             size_t off, size_t size, size_t dist)
+{
+	char *d = (char *)dst;
+	size_t i;
+	if (dist == 0)
+		dist = PR_DISTANCE;
+
+	/* Warm up the pipeline. */
+	for (i = 0; i < dist && i < n; ++i)
+		pr_ahead(blocks, n, i, off, size);
+
+	for (i = 0; i < n; ++i, d += size) {
+		pr_ahead(blocks, n, i + dist, off, size);
+		memcpy(d, (const char *)blocks[i] + off, size);
+	}
+}
+
+#endif  /* PR_H */
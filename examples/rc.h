@@ -0,0 +1,190 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Reference-counted objects with their counts in the same allocation, like
+ * C++'s `std::make_shared()`. The header holding the counts is laid out with
+ * `blprev()` right before the object, so a count update touches the same
+ * cache line as the object's first bytes, or the one before it.
+ *
+ * `rc_retain()` only needs a relaxed increment, since whoever calls it holds
+ * a reference already. `rc_release()` decrements with acquire-release
+ * ordering, so that every other owner's writes to the object happen before
+ * its destructor runs.
+ *
+ * With `RC_WEAK` defined to 1 (the default), objects also carry a weak count:
+ * weak references keep the memory alive, but not the object, and can be
+ * upgraded with `rc_lock()` while the object is still alive. All strong
+ * references together hold a single weak reference, so the block is freed
+ * when both counts are done.
+ *
+ * Uses GCC/Clang `__atomic` builtins. Everything is `static inline`. See
+ * `rc.hpp` for a C++ wrapper. Example usage:
+ * ```c
+ * #include "rc.h"  // rc_*()
+ *
+ * struct obj *o = rc_alloc(sizeof *o, alignof(struct obj), obj_destroy);
+ * if (o == NULL)
+ *     return 1;
+ *
+ * struct obj *p = rc_retain(o);
+ * rc_release(o);
+ * rc_release(p);  // Calls `obj_destroy(p)`, then frees the block.
+ * ```
+ */
+
+#ifndef RC_H
+#define RC_H
+
+/* BL_ALIGNMENT, struct blayout, blcalc(), blprev() */
+#include "blayout.h"
+#include <stddef.h>  /* size_t, offsetof(), NULL */
+#include <stdlib.h>  /* malloc(), free() */
+
+#ifndef RC_WEAK
+#	define RC_WEAK 1
+#endif
+
+#if !defined __GNUC__
+#	error "`rc.h` requires GCC or Clang `__atomic` builtins"
+#endif
+
+typedef void rc_dtor(void *obj);
+
+struct rc_hdr {
+	size_t strong;
+#if RC_WEAK
+	size_t weak;  /* Plus one for all strong references. */
+#endif
+	rc_dtor *dtor;
+	void *blk;
+};
+
+struct rc_hdr_padded {
+	char _c;
+	struct rc_hdr hdr;
+};
+
+#define RC_HDR_ALIGNMENT offsetof(struct rc_hdr_padded, hdr)
+
+static inline struct rc_hdr *rc_hdr(const void *obj)
+{
+	return (struct rc_hdr *)blprev((void *)obj, sizeof(struct rc_hdr),
+	                               RC_HDR_ALIGNMENT);
+}
+
+/*
+ * Allocates an object of `size` bytes, aligned to `align`, with a strong
+ * count of 1. `dtor`, unless NULL, is called on it once the count drops to
+ * 0. Returns NULL if out of memory.
+ */
+static inline void *rc_alloc(size_t size, size_t align, rc_dtor *dtor)
+{
+	struct blayout l[2];
+	struct rc_hdr *h;
+	size_t req, slack;
+	void *blk, *obj;
+	l[0].nmemb = 1;
+	l[0].size = sizeof *h;
+	l[0].align = RC_HDR_ALIGNMENT;
+	l[1].nmemb = 1;
+	l[1].size = size == 0 ? 1 : size;
+	l[1].align = align;
+	req = blcalc(BL_ALIGNMENT, 0, 2, l, 0);
+	/* Laying out from the end; see `aligned-malloc.h`. */
+	slack = align > BL_ALIGNMENT ? align - BL_ALIGNMENT : 0;
+	if (req == 0 || req + slack < req)
+		return NULL;
+
+	blk = malloc(req + slack);
+	if (blk == NULL)
+		return NULL;
+
+	obj = blprev((char *)blk + req + slack, l[1].size, align);
+	h = (struct rc_hdr *)blprev(obj, sizeof *h, RC_HDR_ALIGNMENT);
+	h->strong = 1;
+#if RC_WEAK
+	h->weak = 1;
+#endif
+	h->dtor = dtor;
+	h->blk = blk;
+	return obj;
+}
+
+/*
+ * Frees an object from `rc_alloc()` without calling its destructor, e.g. when
+ * its construction failed. Only valid while nobody else references it.
+ */
+static inline void rc_discard(void *obj)
+{
+	free(rc_hdr(obj)->blk);
+}
+
+static inline void *rc_retain(void *obj)
+{
+	__atomic_fetch_add(&rc_hdr(obj)->strong, 1, __ATOMIC_RELAXED);
+	return obj;
+}
+
+/* Only a hint, unless the caller holds the only reference. */
+static inline size_t rc_count(const void *obj)
+{
+	return __atomic_load_n(&rc_hdr(obj)->strong, __ATOMIC_RELAXED);
+}
+
+#if RC_WEAK
+static inline void *rc_weak_retain(void *obj)
+{
+	__atomic_fetch_add(&rc_hdr(obj)->weak, 1, __ATOMIC_RELAXED);
+	return obj;
+}
+
+/* Drops a weak reference; frees the block if it was the last one. */
+static inline void rc_weak_release(void *obj)
+{
+	struct rc_hdr *h = rc_hdr(obj);
+	if (__atomic_fetch_sub(&h->weak, 1, __ATOMIC_ACQ_REL) == 1)
+		free(h->blk);
+}
+
+/*
+ * Upgrades a weak reference: returns `obj` with a new strong reference, or
+ * NULL if the object has been destroyed already.
+ */
+static inline void *rc_lock(void *obj)
+{
+	struct rc_hdr *h = rc_hdr(obj);
+	size_t n = __atomic_load_n(&h->strong, __ATOMIC_RELAXED);
+	do {
+		if (n == 0)
+			return NULL;
+	} while (!__atomic_compare_exchange_n(&h->strong, &n, n + 1, 1,
+	                                      __ATOMIC_ACQUIRE,
+	                                      __ATOMIC_RELAXED));
+	return obj;
+}
+#endif
+
+/*
+ * Drops a strong reference. Returns 1 if it was the last one, in which case
+ * the object has been destroyed (and freed, unless weak references remain).
+ */
+static inline int rc_release(void *obj)
+{
+	struct rc_hdr *h = rc_hdr(obj);
+	if (__atomic_fetch_sub(&h->strong, 1, __ATOMIC_ACQ_REL) != 1)
+		return 0;
+
+	if (h->dtor != NULL)
+		h->dtor(obj);
+#if RC_WEAK
+	rc_weak_release(obj);
+#else
+	free(h->blk);
+#endif
+	return 1;
+}
+
+#undef RC_HDR_ALIGNMENT
+
+#endif  /* RC_H */
@@ -0,0 +1,231 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * C++11 wrapper around `rc.h`: `bl::rc<T>` is a `std::shared_ptr<T>` look-
+ * alike whose counts live right before the object, in the same allocation,
+ * and `bl::make_rc<T>()` is its `std::make_shared<T>()`. With `RC_WEAK`,
+ * `bl::weak_rc<T>` is the matching `std::weak_ptr<T>`.
+ *
+ * Unlike `std::shared_ptr`, there's no aliasing and no custom deleters, and
+ * the pointer always points to the start of the object it owns.
+ *
+ * Example usage:
+ * ```cpp
+ * #include "rc.hpp"
+ *
+ * bl::rc<std::string> s = bl::make_rc<std::string>("hello");
+ * bl::rc<std::string> t = s;  // Relaxed increment.
+ * bl::weak_rc<std::string> w = s;
+ * if (bl::rc<std::string> u = w.lock())
+ *     std::cout << *u << '\n';
+ * ```
+ */
+
+#ifndef BL_RC_HPP
+#define BL_RC_HPP
+
+#if defined __GNUC__ && !defined __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wregister"  /* C++17 dropped `register`. */
+#endif
+#include "rc.h"        /* rc_*() */
+#include <cstddef>     /* std::size_t, std::nullptr_t */
+#include <new>         /* std::bad_alloc, placement new */
+#include <utility>     /* std::forward(), std::swap() */
+
+namespace bl {
+
+template <class T> class weak_rc;
+
+template <class T>
+class rc {
+public:
+	using element_type = T;
+
+	constexpr rc() noexcept = default;
+	constexpr rc(std::nullptr_t) noexcept {}
+
+	rc(const rc &o) noexcept : p_(o.p_)
+	{
+		if (p_ != nullptr)
+			rc_retain(p_);
+	}
+
+	rc(rc &&o) noexcept : p_(o.p_)
+	{
+		o.p_ = nullptr;
+	}
+
+	~rc()
+	{
+		reset();
+	}
+
+	rc &operator=(rc o) noexcept
+	{
+		swap(o);
+		return *this;
+	}
+
+	void reset() noexcept
+	{
+		if (p_ != nullptr) {
+			rc_release(p_);
+			p_ = nullptr;
+		}
+	}
+
+	void swap(rc &o) noexcept
+	{
+		std::swap(p_, o.p_);
+	}
+
+	T *get() const noexcept { return p_; }
+	T &operator*() const noexcept { return *p_; }
+	T *operator->() const noexcept { return p_; }
+	explicit operator bool() const noexcept { return p_ != nullptr; }
+
+	std::size_t use_count() const noexcept
+	{
+		return p_ != nullptr ? rc_count(p_) : 0;
+	}
+
+	/* Takes over a reference from `rc_alloc()`/`rc_retain()`. */
+	static rc adopt(T *p) noexcept
+	{
+		rc r;
+		r.p_ = p;
+		return r;
+	}
+
+	/* Gives up the reference, to be dropped with `rc_release()`. */
+	T *release() noexcept
+	{
+		T *p = p_;
+		p_ = nullptr;
+		return p;
+	}
+
+private:
+	T *p_ = nullptr;
+};
+
+template <class T>
+bool operator==(const rc<T> &a, const rc<T> &b) noexcept
+{
+	return a.get() == b.get();
+}
+
+template <class T>
+bool operator!=(const rc<T> &a, const rc<T> &b) noexcept
+{
+	return a.get() != b.get();
+}
+
+template <class T>
+void swap(rc<T> &a, rc<T> &b) noexcept
+{
+	a.swap(b);
+}
+
+namespace detail {
+template <class T>
+void rc_destroy(void *p)
+{
+	static_cast<T *>(p)->~T();
+}
+}  /* namespace detail */
+
+/* Throws `std::bad_alloc`, or whatever `T`'s constructor throws. */
+template <class T, class... Args>
+rc<T> make_rc(Args &&...args)
+{
+	void *p = rc_alloc(sizeof(T), alignof(T), detail::rc_destroy<T>);
+	if (p == nullptr)
+		throw std::bad_alloc();
+
+	try {
+		return rc<T>::adopt(::new (p) T(std::forward<Args>(args)...));
+	} catch (...) {
+		rc_discard(p);
+		throw;
+	}
+}
+
+#if RC_WEAK
+template <class T>
+class weak_rc {
+public:
+	constexpr weak_rc() noexcept = default;
+
+	weak_rc(const rc<T> &r) noexcept : p_(r.get())
+	{
+		if (p_ != nullptr)
+			rc_weak_retain(p_);
+	}
+
+	weak_rc(const weak_rc &o) noexcept : p_(o.p_)
+	{
+		if (p_ != nullptr)
+			rc_weak_retain(p_);
+	}
+
+	weak_rc(weak_rc &&o) noexcept : p_(o.p_)
+	{
+		o.p_ = nullptr;
+	}
+
+	~weak_rc()
+	{
+		reset();
+	}
+
+	weak_rc &operator=(weak_rc o) noexcept
+	{
+		swap(o);
+		return *this;
+	}
+
+	void reset() noexcept
+	{
+		if (p_ != nullptr) {
+			rc_weak_release(p_);
+			p_ = nullptr;
+		}
+	}
+
+	void swap(weak_rc &o) noexcept
+	{
+		std::swap(p_, o.p_);
+	}
+
+	/* An empty `rc<T>` if the object is gone. */
+	rc<T> lock() const noexcept
+	{
+		return p_ != nullptr && rc_lock(p_) != nullptr ? rc<T>::adopt(p_)
+		                                               : rc<T>();
+	}
+
+	bool expired() const noexcept
+	{
+		return p_ == nullptr || rc_count(p_) == 0;
+	}
+
+private:
+	T *p_ = nullptr;
+};
+
+template <class T>
+void swap(weak_rc<T> &a, weak_rc<T> &b) noexcept
+{
+	a.swap(b);
+}
+#endif
+
+}  /* namespace bl */
+
+#if defined __GNUC__ && !defined __clang__
+#pragma GCC diagnostic pop
+#endif
+#endif  /* BL_RC_HPP */
@@ -0,0 +1,394 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Read-copy-update for immutable blocks that get replaced wholesale: readers
+ * load the current block from a shared pointer without any locks, writers
+ * build a new block, publish it with an atomic exchange and retire the old
+ * one, which is freed once no reader can still be looking at it.
+ *
+ * Reclamation is quiescent-state based (QSBR). Every reader thread registers
+ * a `struct rcu_reader` and calls `rcu_quiescent()` at points where it holds
+ * no pointers obtained with `rcu_read()`, e.g. between requests. That's a
+ * load and, at most, a store to the reader's own cache line: readers never
+ * lock, nor do atomic read-modify-writes, and on x86 they're plain moves. A
+ * reader that blocks for long should go `rcu_offline()`, or it holds back
+ * reclamation (though never other readers, nor writers).
+ *
+ * Retiring bumps a global epoch; a retired block is freed once every online
+ * reader has announced that epoch or a later one. `rcu_retire()` frees blocks
+ * from `rcu_alloc()`, whose bookkeeping lives in the same allocation, so it
+ * can't fail; `rcu_retire_fn()` takes a block from any allocator along with
+ * the function that frees it, e.g. `aligned_free()` or `free()`. Reclamation
+ * is attempted every `RCU_BATCH` retirements, and by `rcu_reclaim()`.
+ * Writers are serialized by a mutex, which readers never touch.
+ *
+ * Requires POSIX threads and GCC/Clang `__atomic` builtins. Implemented as a
+ * "header library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define RCU_API static  // Fine if used in a single translation unit.
+ * #define RCU_IMPL        // Include the implementation here.
+ * #include "rcu.h"        // struct rcu_domain, struct rcu_reader, rcu_*()
+ *
+ * static struct rcu_domain dom;  // `rcu_init(&dom)` once, at startup.
+ * static void *table;            // Set with `rcu_publish()`.
+ *
+ * // A reader thread:
+ * struct rcu_reader r;
+ * rcu_register(&dom, &r);
+ * for (;;) {
+ *     const struct route *t = rcu_read(&table);
+ *     // ... use `t` ...
+ *     rcu_quiescent(&dom, &r);  // `t` is dead from here on.
+ * }
+ *
+ * // The writer:
+ * void *next = rcu_alloc(n, lays);  // Filled in, then never modified.
+ * rcu_retire(&dom, rcu_publish(&table, next));
+ * ```
+ */
+
+#ifndef RCU_H
+#define RCU_H
+
+#include "blayout.h"  /* struct blayout */
+#include <pthread.h>  /* pthread_mutex_t */
+#include <stddef.h>   /* size_t */
+
+#ifndef RCU_API
+#	define RCU_API
+#endif
+
+/* Retirements between reclamation attempts. */
+#ifndef RCU_BATCH
+#	define RCU_BATCH 64
+#endif
+
+#if !defined __GNUC__
+#	error "`rcu.h` requires GCC or Clang `__atomic` builtins"
+#endif
+
+typedef void rcu_free_fn(void *block);
+
+struct rcu_node;
+
+/* One per reader thread. Padded, so that readers don't share cache lines. */
+struct rcu_reader {
+	unsigned long seen;       /* Last epoch announced, 0 while offline. */
+	struct rcu_reader *next;  /* Under `rcu_domain.lock`. */
+} __attribute__((__aligned__(64)));
+
+struct rcu_domain {
+	unsigned long epoch;      /* Accessed atomically. */
+	pthread_mutex_t lock;
+	struct rcu_reader *readers;
+	struct rcu_node *retired;
+	size_t nretired;
+	size_t since;             /* Retirements since the last reclamation. */
+};
+
+/* Returns 0, or an error number. */
+RCU_API int rcu_init(struct rcu_domain *d);
+
+/* Frees every retired block. No reader may be registered anymore. */
+RCU_API void rcu_destroy(struct rcu_domain *d);
+
+/* Adds a reader, online. Returns 0, or an error number. */
+RCU_API int rcu_register(struct rcu_domain *d, struct rcu_reader *r);
+RCU_API void rcu_unregister(struct rcu_domain *d, struct rcu_reader *r);
+
+/*
+ * Allocates a block of the size `blcalc()` gives for `lays`, aligned to
+ * `BL_ALIGNMENT`, that `rcu_retire()` can free. Returns NULL if out of memory.
+ * Before it's published, the block may be freed with `rcu_discard()`.
+ */
+RCU_API void *rcu_alloc(size_t n, const struct blayout *lays);
+RCU_API void rcu_discard(void *block);
+
+/* Stores `block` into `*slot` and returns the block it replaces. */
+static inline void *rcu_publish(void **slot, void *block)
+{
+	return __atomic_exchange_n(slot, block, __ATOMIC_ACQ_REL);
+}
+
+/* Frees `block`, from `rcu_alloc()`, once no reader can be using it. */
+RCU_API void rcu_retire(struct rcu_domain *d, void *block);
+
+/*
+ * Calls `fn(block)` once no reader can be using `block`. If out of memory,
+ * waits for that, with `rcu_synchronize()`, and calls it right away.
+ */
+RCU_API void rcu_retire_fn(struct rcu_domain *d, void *block, rcu_free_fn *fn);
+
+/*
+ * Frees the retired blocks no reader can be using anymore. Returns how many
+ * are left.
+ */
+RCU_API size_t rcu_reclaim(struct rcu_domain *d);
+
+/*
+ * Waits until every online reader has gone through a quiescent state. Must
+ * not be called by an online reader.
+ */
+RCU_API void rcu_synchronize(struct rcu_domain *d);
+
+/* Loads the current block. Valid until the next `rcu_quiescent()`. */
+static inline void *rcu_read(void *const *slot)
+{
+	return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+/* Announces that `r` holds no pointers from `rcu_read()`. */
+static inline void rcu_quiescent(struct rcu_domain *d, struct rcu_reader *r)
+{
+	unsigned long e = __atomic_load_n(&d->epoch, __ATOMIC_ACQUIRE);
+	/* Don't dirty the line, which writers poll, if nothing changed. */
+	if (__atomic_load_n(&r->seen, __ATOMIC_RELAXED) != e)
+		__atomic_store_n(&r->seen, e, __ATOMIC_RELEASE);
+}
+
+/* Announces a quiescent state that lasts until `rcu_online()`. */
+static inline void rcu_offline(struct rcu_domain *d, struct rcu_reader *r)
+{
+	(void)d;
+	__atomic_store_n(&r->seen, 0, __ATOMIC_RELEASE);
+}
+
+static inline void rcu_online(struct rcu_domain *d, struct rcu_reader *r)
+{
+	__atomic_store_n(&r->seen, __atomic_load_n(&d->epoch, __ATOMIC_ACQUIRE),
+	                 __ATOMIC_RELAXED);
+	/*
+	 * A writer that hasn't seen us yet may have skipped us; either it did
+	 * so before our next `rcu_read()` sees its block, or it sees us.
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif  /* RCU_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef RCU_IMPL
+
+/* BL_ALIGNMENT, struct blayout, blcalc(), blprev() */
+#include "blayout.h"
+#include <pthread.h>  /* pthread_mutex_*() */
+#include <sched.h>    /* sched_yield() */
+#include <stddef.h>   /* size_t, offsetof(), NULL */
+#include <stdlib.h>   /* malloc(), free() */
+
+#define RCU_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+struct rcu_node {
+	struct rcu_node *next;
+	unsigned long epoch;  /* Freeable once every reader has seen it. */
+	rcu_free_fn *fn;      /* NULL if from `rcu_alloc()`. */
+	void *block;          /* Or, from `rcu_alloc()`, the allocation. */
+};
+
+struct rcu_node_padded {
+	char _c;
+	struct rcu_node node;
+};
+
+#define RCU_NODE_ALIGNMENT offsetof(struct rcu_node_padded, node)
+
+RCU_API int rcu_init(struct rcu_domain *d)
+{
+	d->epoch = 1;
+	d->readers = NULL;
+	d->retired = NULL;
+	d->nretired = 0;
+	d->since = 0;
+	return pthread_mutex_init(&d->lock, NULL);
+}
+
+static void rcu_free(struct rcu_node *n)
+{
+	if (n->fn == NULL) {
+		free(n->block);  /* The node is in there too. */
+	} else {
+		n->fn(n->block);
+		free(n);
+	}
+}
+
+RCU_API void rcu_destroy(struct rcu_domain *d)
+{
+	struct rcu_node *n = d->retired;
+	while (n != NULL) {
+		struct rcu_node *next = n->next;
+		rcu_free(n);
+		n = next;
+	}
+	pthread_mutex_destroy(&d->lock);
+}
+
+RCU_API int rcu_register(struct rcu_domain *d, struct rcu_reader *r)
+{
+	int e = pthread_mutex_lock(&d->lock);
+	if (RCU_UNLIKELY(e != 0))
+		return e;
+
+	r->seen = 0;
+	r->next = d->readers;
+	d->readers = r;
+	pthread_mutex_unlock(&d->lock);
+	rcu_online(d, r);
+	return 0;
+}
+
+RCU_API void rcu_unregister(struct rcu_domain *d, struct rcu_reader *r)
+{
+	struct rcu_reader **p;
+	rcu_offline(d, r);
+	pthread_mutex_lock(&d->lock);
+	for (p = &d->readers; *p != NULL; p = &(*p)->next) {
+		if (*p == r) {
+			*p = r->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&d->lock);
+}
+
+RCU_API void *rcu_alloc(size_t n, const struct blayout *lays)
+{
+	struct blayout l[2];
+	struct rcu_node *node;
+	size_t req;
+	void *blk, *block;
+	/* The node goes right before the block, like the header in `rc.h`. */
+	l[0].nmemb = 1;
+	l[0].size = sizeof *node;
+	l[0].align = RCU_NODE_ALIGNMENT;
+	l[1].nmemb = 1;
+	l[1].size = blcalc(BL_ALIGNMENT, 0, n, lays, 0);
+	l[1].align = BL_ALIGNMENT;
+	if (RCU_UNLIKELY(l[1].size == 0))
+		return NULL;
+
+	req = blcalc(BL_ALIGNMENT, 0, 2, l, 0);
+	if (RCU_UNLIKELY(req == 0))
+		return NULL;
+
+	blk = malloc(req);
+	if (RCU_UNLIKELY(blk == NULL))
+		return NULL;
+
+	block = blprev((char *)blk + req, l[1].size, BL_ALIGNMENT);
+	node = (struct rcu_node *)blprev(block, sizeof *node,
+	                                 RCU_NODE_ALIGNMENT);
+	node->fn = NULL;
+	node->block = blk;
+	return block;
+}
+
+static struct rcu_node *rcu_node_of(void *block)
+{
+	return (struct rcu_node *)blprev(block, sizeof(struct rcu_node),
+	                                 RCU_NODE_ALIGNMENT);
+}
+
+RCU_API void rcu_discard(void *block)
+{
+	free(rcu_node_of(block)->block);
+}
+
+/* The smallest epoch announced by an online reader. Under `d->lock`. */
+static unsigned long rcu_min_seen(struct rcu_domain *d)
+{
+	unsigned long min = __atomic_load_n(&d->epoch, __ATOMIC_SEQ_CST);
+	const struct rcu_reader *r;
+	/* Pairs with the fence in `rcu_online()`. */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (r = d->readers; r != NULL; r = r->next) {
+		unsigned long s = __atomic_load_n(&r->seen, __ATOMIC_ACQUIRE);
+		if (s != 0 && s < min)
+			min = s;
+	}
+	return min;
+}
+
+/* Under `d->lock`. */
+static size_t rcu_reclaim_locked(struct rcu_domain *d)
+{
+	const unsigned long min = rcu_min_seen(d);
+	struct rcu_node **p = &d->retired;
+	d->since = 0;
+	while (*p != NULL) {
+		struct rcu_node *n = *p;
+		if (n->epoch <= min) {
+			*p = n->next;
+			--d->nretired;
+			rcu_free(n);
+		} else {
+			p = &n->next;
+		}
+	}
+	return d->nretired;
+}
+
+static void rcu_push(struct rcu_domain *d, struct rcu_node *n)
+{
+	pthread_mutex_lock(&d->lock);
+	/* Every reader that announces this has stopped seeing the block. */
+	n->epoch = __atomic_add_fetch(&d->epoch, 1, __ATOMIC_SEQ_CST);
+	n->next = d->retired;
+	d->retired = n;
+	++d->nretired;
+	if (++d->since >= RCU_BATCH)
+		rcu_reclaim_locked(d);
+	pthread_mutex_unlock(&d->lock);
+}
+
+RCU_API void rcu_retire(struct rcu_domain *d, void *block)
+{
+	if (block != NULL)
+		rcu_push(d, rcu_node_of(block));
+}
+
+RCU_API void rcu_retire_fn(struct rcu_domain *d, void *block, rcu_free_fn *fn)
+{
+	struct rcu_node *n;
+	if (block == NULL)
+		return;
+
+	n = malloc(sizeof *n);
+	if (RCU_UNLIKELY(n == NULL)) {
+		rcu_synchronize(d);
+		fn(block);
+		return;
+	}
+	n->fn = fn;
+	n->block = block;
+	rcu_push(d, n);
+}
+
+RCU_API size_t rcu_reclaim(struct rcu_domain *d)
+{
+	size_t left;
+	pthread_mutex_lock(&d->lock);
+	left = rcu_reclaim_locked(d);
+	pthread_mutex_unlock(&d->lock);
+	return left;
+}
+
+RCU_API void rcu_synchronize(struct rcu_domain *d)
+{
+	unsigned long e;
+	pthread_mutex_lock(&d->lock);
+	e = __atomic_add_fetch(&d->epoch, 1, __ATOMIC_SEQ_CST);
+	while (rcu_min_seen(d) < e)
+		sched_yield();
+	pthread_mutex_unlock(&d->lock);
+}
+
+#undef RCU_NODE_ALIGNMENT
+#undef RCU_UNLIKELY
+
+#undef RCU_IMPL
+#endif  /* RCU_IMPL */
@@ -0,0 +1,132 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Small-buffer storage for laid-out blocks: `struct sb` carries an inline,
+ * `BL_ALIGNMENT`-aligned buffer of `SB_CAPACITY` bytes, and `sb_alloc()`
+ * only falls back to `malloc()` when `blcalc()` asks for more than that. Put
+ * a `struct sb` on the stack (or inside another object) and short-lived small
+ * blocks never touch the allocator.
+ *
+ * The block is an ordinary block: lay it out with `blnext()`/`blprev()` like
+ * any other. `sb_block()` returns it. Don't keep pointers into it across
+ * copies of the `struct sb`, since an inline block moves with the copy.
+ *
+ * Everything is `static inline`. Example usage:
+ * ```c
+ * #define SB_CAPACITY 128   // Optional; defaults to 256.
+ * #include "smallbuf.h"     // struct sb, sb_*()
+ *
+ * struct sb sb;
+ * sb_init(&sb);
+ * void *block = sb_alloc(&sb, 2, lays);
+ * if (block == NULL)
+ *     return 1;
+ *
+ * int    *i = blnext(block,                  0, lays[0].align);
+ * double *d = blnext(    i, blsizeof(&lays[0]), lays[1].align);
+ * // ...
+ * sb_free(&sb);
+ * ```
+ */
+
+#ifndef SB_H
+#define SB_H
+
+#include "blayout.h"  /* BL_ALIGNMENT, struct blayout, blcalc() */
+#include <stddef.h>   /* size_t, NULL */
+#include <stdlib.h>   /* malloc(), free() */
+
+#ifndef SB_CAPACITY
+#	define SB_CAPACITY 256
+#endif
+
+/*
+ * Maximally aligned, like `malloc()`'s blocks. These are the members
+ * `BL_ALIGNMENT` itself is derived from, when `max_align_t` isn't available.
+ */
+union sb_storage {
+	unsigned char bytes[SB_CAPACITY];
+	long double _ld;
+	long long _ll;
+	void *_p;
+	void (*_f)(void);
+};
+
+struct sb {
+	void *heap;  /* NULL while the block is inline. */
+	size_t size;
+	union sb_storage inl;
+};
+
+/*
+ * Like any initializer, this zero-fills the rest of the `struct sb`, i.e. all
+ * `SB_CAPACITY` bytes of the inline buffer. Use `sb_init()` where that shows.
+ */
+#define SB_INIT {NULL, 0, {{0}}}
+
+#if defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L \
+		&& !defined __cplusplus
+_Static_assert(_Alignof(union sb_storage) >= BL_ALIGNMENT,
+               "`union sb_storage` must be `BL_ALIGNMENT`-aligned");
+#elif defined __cplusplus && __cplusplus >= 201103L
+static_assert(alignof(union sb_storage) >= BL_ALIGNMENT,
+              "`union sb_storage` must be `BL_ALIGNMENT`-aligned");
+#endif
+
+static inline void *sb_block(struct sb *s)
+{
+	return s->heap != NULL ? s->heap : (void *)s->inl.bytes;
+}
+
+static inline size_t sb_size(const struct sb *s)
+{
+	return s->size;
+}
+
+static inline int sb_on_heap(const struct sb *s)
+{
+	return s->heap != NULL;
+}
+
+/* Same as `SB_INIT`, but leaves the inline buffer uninitialized. */
+static inline void sb_init(struct sb *s)
+{
+	s->heap = NULL;
+	s->size = 0;
+}
+
+/*
+ * Frees the heap block, if any. `s` may then be reused, as if it was
+ * initialized with `sb_init()`.
+ */
+static inline void sb_free(struct sb *s)
+{
+	free(s->heap);
+	s->heap = NULL;
+	s->size = 0;
+}
+
+/*
+ * Makes room for the `n` regions in `lays`, inline if possible, replacing any
+ * previous block. Returns the block, or NULL if `blcalc()` or `malloc()`
+ * fails (in which case `s` holds no block).
+ */
+static inline void *sb_alloc(struct sb *s, size_t n,
+                             const struct blayout *lays)
+{
+	size_t size = blcalc(BL_ALIGNMENT, 0, n, lays, 0);
+	sb_free(s);
+	if (size == 0)
+		return NULL;
+
+	if (size > SB_CAPACITY) {
+		s->heap = malloc(size);
+		if (s->heap == NULL)
+			return NULL;
+	}
+	s->size = size;
+	return sb_block(s);
+}
+
+#endif  /* SB_H */
@@ -0,0 +1,377 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Copy-on-write snapshots of a laid-out block. The block lives in a
+ * `memfd_create()` file, and `snap_take()` returns a read-only view of the
+ * whole block as it is at that moment, without copying it: the snapshot maps
+ * the file, and the block is remapped `MAP_PRIVATE` over the same file, in
+ * place, so that the pages writers touch from then on get copied by the
+ * kernel, one at a time, while the file (and the snapshot) stay as they were.
+ * The cost of taking a snapshot is in the page tables, not in the data.
+ *
+ * Pages that have been copied are folded back into the file the next time a
+ * snapshot is taken, once every earlier snapshot has been released; they're
+ * found through `/proc/self/pagemap`, or the whole block is written back if
+ * that can't be read. While an earlier snapshot is still alive, the file
+ * must stay as it is, so the block stays copy-on-write over it and the new
+ * snapshot maps it copy-on-write too, with the pages the block has changed
+ * since the file was last brought up to date copied in. Either way, the
+ * cost is in the pages that were written to, not in the size of the block,
+ * but while snapshots overlap those pages add up: the file is only brought
+ * up to date by a `snap_take()` that finds no snapshot alive.
+ *
+ * The block is page-aligned and its address never changes, so pointers into
+ * it stay valid across snapshots, and the same offsets work on both; see
+ * `snap_at()`. No thread may write to the block during `snap_take()`, which
+ * is what makes the snapshot consistent: callers exclude writers with
+ * whatever already makes their updates atomic. Snapshots may be read and
+ * released from any thread, and may outlive the block.
+ *
+ * Requires Linux, for `memfd_create()` and `mremap()` (`_GNU_SOURCE` under
+ * glibc), and GCC or Clang `__atomic` builtins. Implemented as a "header
+ * library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define SNAP_API static  // Fine if used in a single translation unit.
+ * #define SNAP_IMPL        // Include the implementation here.
+ * #include "snapshot.h"    // struct snap_block, struct snap, snap_*()
+ *
+ * const struct blayout lays[] = {{n, sizeof(int), alignof(int)},
+ *                                {n, sizeof(double), alignof(double)}};
+ * struct snap_block b;
+ * if (snap_init(&b, 2, lays) != 0)
+ *     return 1;
+ *
+ * int *ids = blnext(b.base, 0, lays[0].align);
+ * double *vals = blnext(ids, blsizeof(&lays[0]), lays[1].align);
+ *
+ * // ...
+ *
+ * struct snap s;
+ * if (snap_take(&b, &s) != 0)  // With the writers held off.
+ *     return 1;
+ *
+ * const double *old = snap_at(&b, &s, vals);  // Won't change anymore.
+ * // ...
+ * snap_release(&s);
+ * snap_destroy(&b);
+ * ```
+ */
+
+#ifndef SNAP_H
+#define SNAP_H
+
+#include "blayout.h"  /* struct blayout */
+#include <stddef.h>   /* size_t */
+
+#ifndef SNAP_API
+#	define SNAP_API
+#endif
+
+struct snap_file;
+
+struct snap_block {
+	void *base;              /* The block, page-aligned. */
+	size_t size;             /* Whole pages. */
+	size_t page;
+	struct snap_file *file;  /* What `base` maps. */
+	int priv;                /* Whether `base` is copy-on-write. */
+};
+
+struct snap {
+	const void *base;
+	size_t size;
+	struct snap_file *file;
+};
+
+/*
+ * Creates a zeroed block, of the size `blcalc()` gives for `lays`. Alignments
+ * up to the page size are honored. Returns 0, or -1 and `errno`.
+ */
+SNAP_API int snap_init(struct snap_block *b, size_t n,
+                       const struct blayout *lays);
+
+/* Unmaps the block. Snapshots of it remain valid. */
+SNAP_API void snap_destroy(struct snap_block *b);
+
+/* Snapshots the block. Returns 0, or -1 and `errno`. */
+SNAP_API int snap_take(struct snap_block *b, struct snap *s);
+
+SNAP_API void snap_release(struct snap *s);
+
+/* Where `p`, which points into `b`, is in `s`. */
+SNAP_API const void *snap_at(const struct snap_block *b, const struct snap *s,
+                             const void *p);
+
+#endif  /* SNAP_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef SNAP_IMPL
+
+#include "blayout.h"   /* blcalc() */
+#include <errno.h>     /* errno, EINTR, EINVAL, ENOMEM */
+#include <fcntl.h>     /* open(), O_RDONLY, O_CLOEXEC */
+#include <stdint.h>    /* uint64_t, uintptr_t */
+#include <stdlib.h>    /* malloc(), free() */
+#include <string.h>    /* memcpy() */
+/* mmap(), mremap(), mprotect(), munmap(), memfd_create(), MFD_CLOEXEC */
+#include <sys/mman.h>
+#include <unistd.h>    /* ftruncate(), pread(), pwrite(), close(), sysconf() */
+
+#if !defined __GNUC__
+#	error "`snapshot.h` requires GCC or Clang `__atomic` builtins"
+#endif
+
+#define SNAP_UNLIKELY(x) __builtin_expect(!!(x), 0)
+
+/* How many `/proc/self/pagemap` entries are read at once. */
+#define SNAP_PAGEMAP_BATCH 512
+
+struct snap_file {
+	int fd;
+	unsigned refs;  /* The block, if it maps the file, and its snapshots. */
+};
+
+static struct snap_file *snap_file_new(size_t size)
+{
+	struct snap_file *f = malloc(sizeof *f);
+	int e;
+	if (SNAP_UNLIKELY(f == NULL))
+		return NULL;
+
+	f->fd = memfd_create("blayout-snapshot", MFD_CLOEXEC);
+	if (SNAP_UNLIKELY(f->fd < 0)) {
+		free(f);
+		return NULL;
+	}
+	if (SNAP_UNLIKELY(ftruncate(f->fd, (off_t)size) != 0)) {
+		e = errno;
+		close(f->fd);
+		free(f);
+		errno = e;
+		return NULL;
+	}
+	f->refs = 1;
+	return f;
+}
+
+static void snap_file_unref(struct snap_file *f)
+{
+	if (__atomic_sub_fetch(&f->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+		close(f->fd);
+		free(f);
+	}
+}
+
+static int snap_write(int fd, const char *p, size_t len, size_t off)
+{
+	while (len > 0) {
+		ssize_t r = pwrite(fd, p, len, (off_t)off);
+		if (SNAP_UNLIKELY(r < 0)) {
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+		p += r;
+		off += (size_t)r;
+		len -= (size_t)r;
+	}
+	return 0;
+}
+
+/*
+ * A page of a private file mapping that was written to is no longer the
+ * file's: it's swapped out (bit 62) or present (63) but not a file page (61).
+ */
+static int snap_dirty(uint64_t e)
+{
+	return (e >> 62 & 1) || ((e >> 63 & 1) && !(e >> 61 & 1));
+}
+
+/* Copies `len` bytes at `off` in the block to `dst`, or to the file if NULL. */
+static int snap_put(const struct snap_block *b, char *dst, size_t off,
+                    size_t len)
+{
+	const char *src = (const char *)b->base + off;
+	if (dst == NULL)
+		return snap_write(b->file->fd, src, len, off);
+
+	memcpy(dst + off, src, len);
+	return 0;
+}
+
+/*
+ * Copies the pages of the block that differ from the file to `dst`, a
+ * mapping of the file, or back into the file itself if `dst` is NULL.
+ */
+static int snap_copy_dirty(const struct snap_block *b, char *dst)
+{
+	uint64_t ents[SNAP_PAGEMAP_BATCH];
+	const size_t npages = b->size / b->page;
+	const size_t first = (uintptr_t)b->base / b->page;
+	size_t i, j, k;
+	int pm = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if (SNAP_UNLIKELY(pm < 0))
+		return snap_put(b, dst, 0, b->size);
+
+	for (i = 0; i < npages; i += SNAP_PAGEMAP_BATCH) {
+		size_t cnt = npages - i < SNAP_PAGEMAP_BATCH ? npages - i
+		                                             : SNAP_PAGEMAP_BATCH;
+		if (SNAP_UNLIKELY(pread(pm, ents, cnt * sizeof *ents,
+		                        (off_t)((first + i) * sizeof *ents))
+		                  != (ssize_t)(cnt * sizeof *ents))) {
+			close(pm);
+			return snap_put(b, dst, i * b->page, b->size - i * b->page);
+		}
+
+		for (j = 0; j < cnt; ++j) {
+			if (!snap_dirty(ents[j]))
+				continue;
+
+			for (k = j + 1; k < cnt && snap_dirty(ents[k]); ++k)
+				;
+			if (SNAP_UNLIKELY(snap_put(b, dst, (i + j) * b->page,
+			                           (k - j) * b->page) != 0)) {
+				close(pm);
+				return -1;
+			}
+			j = k;
+		}
+	}
+	close(pm);
+	return 0;
+}
+
+SNAP_API int snap_init(struct snap_block *b, size_t n,
+                       const struct blayout *lays)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	size_t size;
+	void *p;
+	if (SNAP_UNLIKELY(n == 0 || page <= 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	b->page = (size_t)page;
+	size = blcalc(b->page, 0, n, lays, 0);
+	if (SNAP_UNLIKELY(size == 0 || size + b->page - 1 < size)) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	b->size = (size + b->page - 1) & ~(b->page - 1);
+	b->file = snap_file_new(b->size);
+	if (SNAP_UNLIKELY(b->file == NULL))
+		return -1;
+
+	/* Shared until the first snapshot, so that writes go to the file. */
+	p = mmap(NULL, b->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+	         b->file->fd, 0);
+	if (SNAP_UNLIKELY(p == MAP_FAILED)) {
+		snap_file_unref(b->file);
+		return -1;
+	}
+	b->base = p;
+	b->priv = 0;
+	return 0;
+}
+
+SNAP_API void snap_destroy(struct snap_block *b)
+{
+	munmap(b->base, b->size);
+	snap_file_unref(b->file);
+}
+
+SNAP_API int snap_take(struct snap_block *b, struct snap *s)
+{
+	struct snap_file *f = b->file;
+	void *view, *p;
+	int e;
+	if (__atomic_load_n(&f->refs, __ATOMIC_ACQUIRE) != 1) {
+		/*
+		 * Older snapshots still read the file, so it can't be brought up
+		 * to date. The block stays as it is, copy-on-write over the file
+		 * (it already is, once there's been a snapshot), and so does the
+		 * new snapshot, with the pages the block changed copied in.
+		 */
+		view = mmap(NULL, b->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+		            f->fd, 0);
+		if (SNAP_UNLIKELY(view == MAP_FAILED))
+			return -1;
+		if (SNAP_UNLIKELY(snap_copy_dirty(b, view) != 0
+		                  || mprotect(view, b->size, PROT_READ) != 0)) {
+			e = errno;
+			munmap(view, b->size);
+			errno = e;
+			return -1;
+		}
+
+		__atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED);
+		s->base = view;
+		s->size = b->size;
+		s->file = f;
+		return 0;
+	}
+
+	/* Nothing else reads the file; bring it up to date. */
+	if (b->priv && SNAP_UNLIKELY(snap_copy_dirty(b, NULL) != 0))
+		return -1;
+
+	__atomic_add_fetch(&f->refs, 1, __ATOMIC_RELAXED);
+	view = mmap(NULL, b->size, PROT_READ, MAP_SHARED, f->fd, 0);
+	if (SNAP_UNLIKELY(view == MAP_FAILED))
+		goto error;
+
+	/*
+	 * From now on, the block is copy-on-write over the file. Mapped
+	 * elsewhere first and moved over, since `mremap()` leaves the old
+	 * mapping alone if it fails, unlike `mmap(MAP_FIXED)`. This also drops
+	 * the pages copied since the previous snapshot.
+	 */
+	p = mmap(NULL, b->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, f->fd, 0);
+	if (SNAP_UNLIKELY(p == MAP_FAILED))
+		goto error_view;
+	if (SNAP_UNLIKELY(mremap(p, b->size, b->size,
+	                         MREMAP_MAYMOVE | MREMAP_FIXED, b->base)
+	                  == MAP_FAILED)) {
+		munmap(p, b->size);
+		goto error_view;
+	}
+
+	b->priv = 1;
+	s->base = view;
+	s->size = b->size;
+	s->file = f;
+	return 0;
+
+error_view:
+	e = errno;
+	munmap(view, b->size);
+	errno = e;
+error:
+	snap_file_unref(f);
+	return -1;
+}
+
+SNAP_API void snap_release(struct snap *s)
+{
+	munmap((void *)s->base, s->size);
+	snap_file_unref(s->file);
+}
+
+SNAP_API const void *snap_at(const struct snap_block *b, const struct snap *s,
+                             const void *p)
+{
+	return (const char *)s->base + ((const char *)p - (const char *)b->base);
+}
+
+#undef SNAP_PAGEMAP_BATCH
+#undef SNAP_UNLIKELY
+
+#undef SNAP_IMPL
+#endif  /* SNAP_IMPL */
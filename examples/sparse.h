@@ -0,0 +1,234 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Sparse blocks: the whole address range `blcalc()` asks for is reserved up
+ * front with `mmap(PROT_NONE)`, but only the parts of each region that are
+ * actually used get committed, with `sp_commit()`. A region can then grow
+ * up to the capacity in its layout without ever moving, while the resident
+ * set only tracks what's been committed (and touched).
+ *
+ * Every region starts at a page boundary, so that committing or decommitting
+ * one region never affects another. Reserved-but-unused address space costs
+ * nothing, so the extra padding this needs is free. It also means that
+ * regions are _not_ where `blnext()` would put them; use `sp_region()`.
+ * Alignments beyond the page size aren't supported.
+ *
+ * `sp_decommit()` gives pages back to the OS with `madvise(MADV_DONTNEED)`
+ * and makes them inaccessible again. Their contents are lost.
+ *
+ * Requires `mmap()` with `MAP_ANONYMOUS` (`_DEFAULT_SOURCE` under glibc).
+ * Implemented as a "header library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define SP_API static  // Fine if used in a single translation unit.
+ * #define SP_IMPL        // Include the implementation here.
+ * #include "sparse.h"    // struct sp_block, sp_*()
+ *
+ * const struct blayout lays[] = {{1 << 30, 1, 1}, {1 << 24, 8, 8}};
+ * struct sp_block b;
+ * if (sp_reserve(&b, 2, lays) != 0)
+ *     return 1;
+ *
+ * char *log = sp_region(&b, 0);
+ * if (sp_commit(&b, 0, 4096) != 0)  // Only the first page is usable.
+ *     return 1;
+ *
+ * // ...
+ *
+ * sp_release(&b);
+ * ```
+ */
+
+#ifndef SP_H
+#define SP_H
+
+#include "blayout.h"  /* struct blayout */
+#include <stddef.h>   /* size_t */
+
+#ifndef SP_API
+#	define SP_API
+#endif
+
+struct sp_region {
+	size_t offset;     /* From the start of the block; page-aligned. */
+	size_t capacity;   /* Bytes, from the layout. */
+	size_t committed;  /* Bytes, always whole pages. */
+};
+
+struct sp_block {
+	char *base;
+	size_t size;
+	size_t page;
+	size_t n;
+	struct sp_region *regions;
+};
+
+/* Reserves address space for the `n` regions. Returns 0, or -1 and `errno`. */
+SP_API int sp_reserve(struct sp_block *b, size_t n,
+                      const struct blayout *lays);
+SP_API void sp_release(struct sp_block *b);
+
+SP_API void *sp_region(const struct sp_block *b, size_t i);
+
+/*
+ * Makes (at least) the first `bytes` bytes of region `i` accessible, zeroed
+ * if they weren't before. Returns 0, or -1 and `errno` (`EINVAL` if `bytes`
+ * exceeds the region's capacity).
+ */
+SP_API int sp_commit(struct sp_block *b, size_t i, size_t bytes);
+
+/*
+ * Gives back every page of region `i` past its first `bytes` bytes. Returns 0,
+ * or -1 and `errno`.
+ */
+SP_API int sp_decommit(struct sp_block *b, size_t i, size_t bytes);
+
+/* Bytes committed, over all regions. */
+SP_API size_t sp_committed(const struct sp_block *b);
+
+#endif  /* SP_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef SP_IMPL
+
+#include "blayout.h"   /* blcalc(), blsizeof() */
+#include <errno.h>     /* errno, EINVAL, ENOMEM */
+#include <stdlib.h>    /* malloc(), free() */
+#include <sys/mman.h>  /* mmap(), munmap(), mprotect(), madvise() */
+#include <unistd.h>    /* sysconf() */
+
+#ifdef __GNUC__
+#	define SP_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#	define SP_UNLIKELY(x) (x)
+#endif
+
+SP_API int sp_reserve(struct sp_block *b, size_t n,
+                      const struct blayout *lays)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	size_t pos = 0;
+	size_t i;
+	void *p;
+	if (SP_UNLIKELY(n == 0 || page <= 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (SP_UNLIKELY(n > (size_t)-1 / sizeof *b->regions)) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	b->page = (size_t)page;
+	b->n = n;
+	b->regions = malloc(n * sizeof *b->regions);
+	if (SP_UNLIKELY(b->regions == NULL))
+		return -1;
+
+	/* Same as `blcalc()`, but with every region rounded up to pages. */
+	for (i = 0; i < n; ++i) {
+		struct blayout l = lays[i];
+		if (SP_UNLIKELY(l.align > b->page)) {
+			free(b->regions);
+			b->regions = NULL;
+			errno = EINVAL;
+			return -1;
+		}
+
+		l.align = b->page;
+		pos = blcalc(b->page, 0, 1, &l, pos);
+		if (SP_UNLIKELY(pos == 0 || pos + b->page - 1 < pos))
+			goto error_nomem;
+
+		b->regions[i].capacity = blsizeof(&lays[i]);
+		b->regions[i].offset = pos - b->regions[i].capacity;
+		b->regions[i].committed = 0;
+		pos = (pos + b->page - 1) & ~(b->page - 1);
+	}
+
+	b->size = pos;
+	p = mmap(NULL, b->size, PROT_NONE,
+	         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (SP_UNLIKELY(p == MAP_FAILED))
+		goto error;
+
+	b->base = p;
+	return 0;
+
+error_nomem:
+	errno = ENOMEM;
+error:
+	free(b->regions);
+	b->regions = NULL;
+	return -1;
+}
+
+SP_API void sp_release(struct sp_block *b)
+{
+	if (b->regions != NULL) {
+		munmap(b->base, b->size);
+		free(b->regions);
+		b->regions = NULL;
+	}
+}
+
+SP_API void *sp_region(const struct sp_block *b, size_t i)
+{
+	return b->base + b->regions[i].offset;
+}
+
+SP_API int sp_commit(struct sp_block *b, size_t i, size_t bytes)
+{
+	struct sp_region *r = &b->regions[i];
+	size_t want;
+	if (SP_UNLIKELY(bytes > r->capacity)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	want = (bytes + b->page - 1) & ~(b->page - 1);
+	if (want <= r->committed)
+		return 0;
+
+	if (SP_UNLIKELY(mprotect(b->base + r->offset + r->committed,
+	                         want - r->committed,
+	                         PROT_READ | PROT_WRITE) != 0))
+		return -1;
+
+	r->committed = want;
+	return 0;
+}
+
+SP_API int sp_decommit(struct sp_block *b, size_t i, size_t bytes)
+{
+	struct sp_region *r = &b->regions[i];
+	size_t keep = (bytes + b->page - 1) & ~(b->page - 1);
+	char *p;
+	if (keep >= r->committed)
+		return 0;
+
+	p = b->base + r->offset + keep;
+	if (SP_UNLIKELY(madvise(p, r->committed - keep, MADV_DONTNEED) != 0
+	                || mprotect(p, r->committed - keep, PROT_NONE) != 0))
+		return -1;
+
+	r->committed = keep;
+	return 0;
+}
+
+SP_API size_t sp_committed(const struct sp_block *b)
+{
+	size_t sum = 0;
+	size_t i;
+	for (i = 0; i < b->n; ++i)
+		sum += b->regions[i].committed;
+	return sum;
+}
+
+#undef SP_UNLIKELY
+
+#undef SP_IMPL
+#endif  /* SP_IMPL */
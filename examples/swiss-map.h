@@ -0,0 +1,366 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * A small open-addressing hash map, in the spirit of Abseil's SwissTable,
+ * whose control bytes, keys and values live in a _single_ block sized with
+ * `blcalc()`. The control bytes come first and are 16-byte aligned, so a
+ * group of 16 of them is probed with one aligned SSE2 load. Rehashing is a
+ * single allocation.
+ *
+ * Implemented as a "header library", like `aligned-malloc.h`. The key and
+ * value types, as well as the hash and equality functions, can be overridden
+ * before including the header. Example usage:
+ * ```c
+ * #define SM_API static        // Fine if used in a single translation unit.
+ * #define SM_IMPL              // Include the implementation here.
+ * #include "swiss-map.h"       // struct sm_map, sm_*()
+ *
+ * struct sm_map m = SM_INIT;
+ * if (sm_insert(&m, 42, 1337) == NULL)
+ *     return 1;
+ *
+ * uint64_t *v = sm_find(&m, 42);  // `*v == 1337`.
+ * sm_erase(&m, 42);
+ * sm_free(&m);
+ * ```
+ */
+
+#ifndef SM_H
+#define SM_H
+
+#include <stddef.h>  /* size_t */
+#include <stdint.h>  /* uint64_t */
+
+#ifndef SM_API
+#	define SM_API
+#endif
+
+#ifndef SM_KEY
+#	define SM_KEY   uint64_t
+#endif
+#ifndef SM_VALUE
+#	define SM_VALUE uint64_t
+#endif
+#ifndef SM_HASH
+#	define SM_HASH(k)  sm_hash64(k)
+#endif
+#ifndef SM_EQ
+#	define SM_EQ(a, b) ((a) == (b))
+#endif
+
+#define SM_GROUP 16
+
+struct sm_map {
+	void *blk;          /* The single allocation; `NULL` if empty. */
+	signed char *ctrl;  /* `mask + 1` control bytes. */
+	SM_KEY *keys;       /* `mask + 1` keys. */
+	SM_VALUE *vals;     /* `mask + 1` values. */
+	size_t mask;        /* Capacity minus one, or zero. */
+	size_t size;        /* Number of live entries. */
+	size_t growth;      /* Insertions left before a rehash. */
+};
+
+#define SM_INIT {NULL, NULL, NULL, NULL, 0, 0, 0}
+
+/* Inserts or assigns. Returns a pointer to the value or `NULL` on ENOMEM. */
+SM_API SM_VALUE *sm_insert(struct sm_map *m, SM_KEY key, SM_VALUE val);
+
+SM_API SM_VALUE *sm_find(const struct sm_map *m, SM_KEY key);
+
+/* Returns non-zero if `key` was present. */
+SM_API int sm_erase(struct sm_map *m, SM_KEY key);
+
+/* Makes room for `n` entries without rehashing. Returns 0 on success. */
+SM_API int sm_reserve(struct sm_map *m, size_t n);
+
+/* Bytes taken by the map's single block. */
+SM_API size_t sm_footprint(const struct sm_map *m);
+
+SM_API void sm_free(struct sm_map *m);
+
+static inline uint64_t sm_hash64(uint64_t x)
+{
+	x ^= x >> 32;
+	x *= UINT64_C(0xd6e8feb86659fd93);
+	x ^= x >> 32;
+	x *= UINT64_C(0xd6e8feb86659fd93);
+	return x ^ (x >> 32);
+}
+
+#endif  /* SM_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef SM_IMPL
+
+/* BL_ALIGNMENT, struct blayout, blcalc(), blnext(), blsizeof() */
+#include "blayout.h"
+#include <errno.h>     /* errno, ENOMEM */
+#include <stdalign.h>  /* alignof */
+#include <stdlib.h>    /* malloc(), free() */
+#include <string.h>    /* memset() */
+#ifdef __SSE2__
+#include <emmintrin.h>  /* _mm_*() */
+#endif
+
+#ifdef __GNUC__
+#	define SM_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#	define SM_CTZ(x)      ((unsigned)__builtin_ctz(x))
+#else
+#	define SM_UNLIKELY(x) (x)
+#	define SM_CTZ(x)      sm_ctz(x)
+static unsigned sm_ctz(unsigned x)
+{
+	unsigned n = 0;
+	while (!(x & 1u)) {
+		x >>= 1;
+		++n;
+	}
+	return n;
+}
+#endif
+
+#define SM_EMPTY   ((signed char)-128)
+#define SM_DELETED ((signed char)-2)
+
+#define SM_H1(h) ((size_t)((h) >> 7))
+#define SM_H2(h) ((signed char)((h) & 0x7f))
+
+/* Bit `i` is set if `g[i] == c`. */
+static inline unsigned sm_match(const signed char *g, signed char c)
+{
+#ifdef __SSE2__
+	__m128i v = _mm_load_si128((const __m128i *)(const void *)g);
+	return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+#else
+	unsigned r = 0;
+	unsigned i;
+	for (i = 0; i < SM_GROUP; ++i)
+		r |= (unsigned)(g[i] == c) << i;
+	return r;
+#endif
+}
+
+/* Bit `i` is set if `g[i]` is empty or deleted (i.e. negative). */
+static inline unsigned sm_match_free(const signed char *g)
+{
+#ifdef __SSE2__
+	__m128i v = _mm_load_si128((const __m128i *)(const void *)g);
+	return (unsigned)_mm_movemask_epi8(v);
+#else
+	unsigned r = 0;
+	unsigned i;
+	for (i = 0; i < SM_GROUP; ++i)
+		r |= (unsigned)(g[i] < 0) << i;
+	return r;
+#endif
+}
+
+/*
+ * Probing is group-aligned and visits every group once: triangular steps over
+ * a power-of-2 number of groups.
+ */
+#define SM_PROBE_FIRST(m, h) (SM_H1(h) & (m)->mask & ~(size_t)(SM_GROUP - 1))
+#define SM_PROBE_NEXT(m, pos, i) \
+	(((pos) + (size_t)SM_GROUP * (i)) & (m)->mask)
+
+SM_API SM_VALUE *sm_find(const struct sm_map *m, SM_KEY key)
+{
+	uint64_t h;
+	size_t pos;
+	size_t i;
+	if (m->size == 0)
+		return NULL;
+
+	h = SM_HASH(key);
+	pos = SM_PROBE_FIRST(m, h);
+	for (i = 1;; ++i) {
+		const signed char *g = m->ctrl + pos;
+		unsigned bits = sm_match(g, SM_H2(h));
+		while (bits != 0) {
+			size_t slot = pos + SM_CTZ(bits);
+			if (SM_EQ(m->keys[slot], key))
+				return &m->vals[slot];
+			bits &= bits - 1;
+		}
+
+		if (sm_match(g, SM_EMPTY) != 0)
+			return NULL;
+
+		pos = SM_PROBE_NEXT(m, pos, i);
+	}
+}
+
+/* The first empty or deleted slot on `h`'s probe sequence. */
+static size_t sm_find_free(const struct sm_map *m, uint64_t h)
+{
+	size_t pos = SM_PROBE_FIRST(m, h);
+	size_t i;
+	for (i = 1;; ++i) {
+		unsigned bits = sm_match_free(m->ctrl + pos);
+		if (bits != 0)
+			return pos + SM_CTZ(bits);
+
+		pos = SM_PROBE_NEXT(m, pos, i);
+	}
+}
+
+static int sm_rehash(struct sm_map *m, size_t cap)
+{
+	struct sm_map n;
+	size_t i;
+	const struct blayout l[] = {
+		{cap, 1,                SM_GROUP        },
+		{cap, sizeof(SM_KEY),   alignof(SM_KEY)  },
+		{cap, sizeof(SM_VALUE), alignof(SM_VALUE)}
+	};
+	size_t req = blcalc(BL_ALIGNMENT, 0, 3, l, 0);
+	if (SM_UNLIKELY(req == 0)) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	n.blk = malloc(req);
+	if (SM_UNLIKELY(n.blk == NULL))
+		return -1;
+
+	n.ctrl = blnext(n.blk,  0,                l[0].align);
+	n.keys = blnext(n.ctrl, blsizeof(&l[0]), l[1].align);
+	n.vals = blnext(n.keys, blsizeof(&l[1]), l[2].align);
+	n.mask = cap - 1;
+	n.size = m->size;
+	n.growth = cap - cap / 8 - m->size;
+	memset(n.ctrl, (unsigned char)SM_EMPTY, cap);
+
+	for (i = 0; m->size != 0 && i <= m->mask; ++i) {
+		if (m->ctrl[i] >= 0) {
+			uint64_t h = SM_HASH(m->keys[i]);
+			size_t slot = sm_find_free(&n, h);
+			n.ctrl[slot] = SM_H2(h);
+			n.keys[slot] = m->keys[i];
+			n.vals[slot] = m->vals[i];
+		}
+	}
+
+	free(m->blk);
+	*m = n;
+	return 0;
+}
+
+/* Smallest power-of-2 capacity (at least a group) that holds `n` entries. */
+static size_t sm_capacity_for(size_t n)
+{
+	size_t cap = SM_GROUP;
+	while (cap - cap / 8 < n) {
+		if (SM_UNLIKELY(cap > (size_t)-1 / 2))
+			return 0;
+		cap *= 2;
+	}
+	return cap;
+}
+
+SM_API int sm_reserve(struct sm_map *m, size_t n)
+{
+	size_t cap;
+	if (n <= m->size + m->growth)
+		return 0;
+
+	cap = sm_capacity_for(n);
+	if (SM_UNLIKELY(cap == 0)) {
+		errno = ENOMEM;
+		return -1;
+	}
+	return sm_rehash(m, cap);
+}
+
+SM_API SM_VALUE *sm_insert(struct sm_map *m, SM_KEY key, SM_VALUE val)
+{
+	uint64_t h;
+	size_t slot;
+	SM_VALUE *v = sm_find(m, key);
+	if (v != NULL) {
+		*v = val;
+		return v;
+	}
+
+	if (m->growth == 0) {
+		/* Mostly tombstones? Then rehash in place, otherwise grow. */
+		size_t cap = m->blk == NULL ? SM_GROUP
+		           : m->size <= (m->mask + 1) / 2 ? m->mask + 1
+		           : sm_capacity_for(m->size + 1);
+		if (SM_UNLIKELY(cap == 0)) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		if (SM_UNLIKELY(sm_rehash(m, cap) != 0))
+			return NULL;
+	}
+
+	h = SM_HASH(key);
+	slot = sm_find_free(m, h);
+	m->growth -= m->ctrl[slot] == SM_EMPTY;
+	m->ctrl[slot] = SM_H2(h);
+	m->keys[slot] = key;
+	m->vals[slot] = val;
+	++m->size;
+	return &m->vals[slot];
+}
+
+SM_API int sm_erase(struct sm_map *m, SM_KEY key)
+{
+	size_t slot;
+	size_t group;
+	SM_VALUE *v = sm_find(m, key);
+	if (v == NULL)
+		return 0;
+
+	slot = (size_t)(v - m->vals);
+	group = slot & ~(size_t)(SM_GROUP - 1);
+	/*
+	 * A group with an empty slot stops every probe sequence reaching it, so
+	 * no tombstone is needed there.
+	 */
+	if (sm_match(m->ctrl + group, SM_EMPTY) != 0) {
+		m->ctrl[slot] = SM_EMPTY;
+		++m->growth;
+	} else {
+		m->ctrl[slot] = SM_DELETED;
+	}
+	--m->size;
+	return 1;
+}
+
+SM_API size_t sm_footprint(const struct sm_map *m)
+{
+	const struct blayout l[] = {
+		{m->mask + 1, 1,                SM_GROUP        },
+		{m->mask + 1, sizeof(SM_KEY),   alignof(SM_KEY)  },
+		{m->mask + 1, sizeof(SM_VALUE), alignof(SM_VALUE)}
+	};
+	return m->blk == NULL ? 0 : blcalc(BL_ALIGNMENT, 0, 3, l, 0);
+}
+
+SM_API void sm_free(struct sm_map *m)
+{
+	free(m->blk);
+	m->blk = NULL;
+	m->ctrl = NULL;
+	m->keys = NULL;
+	m->vals = NULL;
+	m->mask = m->size = m->growth = 0;
+}
+
+#undef SM_PROBE_NEXT
+#undef SM_PROBE_FIRST
+#undef SM_H2
+#undef SM_H1
+#undef SM_DELETED
+#undef SM_EMPTY
+#undef SM_CTZ
+#undef SM_UNLIKELY
+
+#undef SM_IMPL
+#endif  /* SM_IMPL */
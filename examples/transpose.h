@@ -0,0 +1,423 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Converting between an array of structs (AoS) and the column regions of a
+ * laid-out block (SoA), e.g. for records received or emitted as packed
+ * structs. Each field of the structs, described by its offset and size, maps
+ * to one region of the block; the regions are found by walking the layouts
+ * with `blnext()`.
+ *
+ * Four consecutive `fields` with 4-byte sizes and contiguous offsets (say,
+ * `float x, y, z, w`) are moved together, as a 4x4 transpose of 32-bit lanes
+ * with SSE2 unpacks, or 8 records at a time with AVX2. Two consecutive 8-byte
+ * fields with contiguous offsets get the same treatment, as a 2x2 transpose
+ * of 64-bit lanes. Every other field is copied one element at a time, with
+ * constant-size copies for 1, 2, 4 and 8 bytes. The rows are processed in
+ * tiles of `TP_TILE`, so that each row is read from memory only once, no
+ * matter how many fields it has.
+ *
+ * Implemented as a "header library", like `aligned-malloc.h`. Example usage:
+ * ```c
+ * #define TP_API static   // Fine if used in a single translation unit.
+ * #define TP_IMPL         // Include the implementation here.
+ * #include "transpose.h"  // struct tp_field, tp_*()
+ *
+ * struct point { float x, y, z, w; uint64_t id; };
+ * const struct tp_field fields[] = {
+ *     {offsetof(struct point, x), 4}, {offsetof(struct point, y), 4},
+ *     {offsetof(struct point, z), 4}, {offsetof(struct point, w), 4},
+ *     {offsetof(struct point, id), 8},
+ * };
+ * // `lays[i]` is `{n, fields[i].size, ...}`, `block` is laid out for `lays`.
+ * if (tp_aos_to_soa(block, lays, points, sizeof *points, n, 5, fields) != 0)
+ *     return 1;
+ * ```
+ */
+
+#ifndef TP_H
+#define TP_H
+
+#include "blayout.h"  /* struct blayout */
+#include <stddef.h>   /* size_t */
+
+#ifndef TP_API
+#	define TP_API
+#endif
+
+/* Rows per tile. */
+#ifndef TP_TILE
+#	define TP_TILE 256
+#endif
+
+struct tp_field {
+	size_t offset;  /* Within a struct. */
+	size_t size;    /* Must equal the size in the matching layout. */
+};
+
+/*
+ * Copies field `i` of each of the `n` structs of `stride` bytes at `aos` into
+ * the region of `block` laid out with `lays[i]`, for every `i < nfields`.
+ * Returns 0, or -1 and `errno` (`EINVAL` if a field doesn't match its layout,
+ * has fewer than `n` elements, or doesn't fit in `stride` bytes).
+ */
+TP_API int tp_aos_to_soa(void *block, const struct blayout *lays,
+                         const void *aos, size_t stride, size_t n,
+                         size_t nfields, const struct tp_field *fields);
+
+/* The reverse of `tp_aos_to_soa()`; bytes outside of `fields` are untouched. */
+TP_API int tp_soa_to_aos(void *aos, size_t stride, size_t n,
+                         const void *block, const struct blayout *lays,
+                         size_t nfields, const struct tp_field *fields);
+
+#endif  /* TP_H */
+
+
+/*
+ * Implementation.
+ */
+#ifdef TP_IMPL
+
+#include "blayout.h"  /* blnext(), blsizeof() */
+#include <errno.h>    /* errno, EINVAL */
+#include <string.h>   /* memcpy() */
+#if defined __AVX2__
+#	include <immintrin.h>  /* __m256i, _mm256_*(), _mm_*() */
+#elif defined __SSE2__ || defined _M_X64
+#	include <emmintrin.h>  /* __m128i, _mm_*() */
+#endif
+
+#ifdef __GNUC__
+#	define TP_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#	define TP_UNLIKELY(x) (x)
+#endif
+
+#if defined __AVX2__ || defined __SSE2__ || defined _M_X64
+#	define TP_LOAD(p)     _mm_loadu_si128((const __m128i *)(const void *)(p))
+#	define TP_STORE(p, v) _mm_storeu_si128((__m128i *)(void *)(p), v)
+#endif
+
+/*
+ * How many fields, starting with `f[0]`, can be moved together: 4 for 4-byte
+ * fields filling 16 contiguous bytes, 2 for 8-byte ones, and otherwise 1.
+ */
+static size_t tp_group(const struct tp_field *f, size_t left)
+{
+	size_t k;
+	if (f[0].size == 4 && left >= 4) {
+		for (k = 1; k < 4; ++k)
+			if (f[k].size != 4 || f[k].offset != f[0].offset + 4 * k)
+				break;
+		if (k == 4)
+			return 4;
+	}
+	if (f[0].size == 8 && left >= 2 && f[1].size == 8
+	    && f[1].offset == f[0].offset + 8)
+		return 2;
+	return 1;
+}
+
+#define TP_MOVE(sz)                                            \
+	do {                                                   \
+		if (out)                                       \
+			for (i = 0; i < count; ++i)            \
+				memcpy(rec + i * stride,       \
+				       col + i * (sz), (sz));  \
+		else                                           \
+			for (i = 0; i < count; ++i)            \
+				memcpy(col + i * (sz),         \
+				       rec + i * stride, (sz)); \
+	} while (0)
+
+/* Moves one field of rows `[0, count)`, in either direction. */
+static void tp_move(char *col, char *rec, size_t stride, size_t size,
+                    size_t count, int out)
+{
+	size_t i;
+	switch (size) {
+	case 1: TP_MOVE(1); break;
+	case 2: TP_MOVE(2); break;
+	case 4: TP_MOVE(4); break;
+	case 8: TP_MOVE(8); break;
+	default: TP_MOVE(size); break;
+	}
+}
+
+#undef TP_MOVE
+
+/*
+ * `col[k]` points to row 0 of field `k`, `rec` to the first of the 16 bytes
+ * of row 0 the fields occupy. Returns the number of rows done.
+ */
+static size_t tp_quad_in(char *const col[4], const char *rec, size_t stride,
+                         size_t count)
+{
+	size_t i = 0;
+#if defined __AVX2__
+	for (; i + 8 <= count; i += 8) {
+		const char *r = rec + i * stride;
+		__m256i r0 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(TP_LOAD(r)),
+			TP_LOAD(r + 4 * stride), 1);
+		__m256i r1 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(TP_LOAD(r + stride)),
+			TP_LOAD(r + 5 * stride), 1);
+		__m256i r2 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(TP_LOAD(r + 2 * stride)),
+			TP_LOAD(r + 6 * stride), 1);
+		__m256i r3 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(TP_LOAD(r + 3 * stride)),
+			TP_LOAD(r + 7 * stride), 1);
+		__m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+		__m256i t1 = _mm256_unpacklo_epi32(r2, r3);
+		__m256i t2 = _mm256_unpackhi_epi32(r0, r1);
+		__m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+		_mm256_storeu_si256((__m256i *)(void *)(col[0] + i * 4),
+		                    _mm256_unpacklo_epi64(t0, t1));
+		_mm256_storeu_si256((__m256i *)(void *)(col[1] + i * 4),
+		                    _mm256_unpackhi_epi64(t0, t1));
+		_mm256_storeu_si256((__m256i *)(void *)(col[2] + i * 4),
+		                    _mm256_unpacklo_epi64(t2, t3));
+		_mm256_storeu_si256((__m256i *)(void *)(col[3] + i * 4),
+		                    _mm256_unpackhi_epi64(t2, t3));
+	}
+#endif
+#if defined __AVX2__ || defined __SSE2__ || defined _M_X64
+	for (; i + 4 <= count; i += 4) {
+		const char *r = rec + i * stride;
+		__m128i r0 = TP_LOAD(r);
+		__m128i r1 = TP_LOAD(r + stride);
+		__m128i r2 = TP_LOAD(r + 2 * stride);
+		__m128i r3 = TP_LOAD(r + 3 * stride);
+		__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+		__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+		__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+		__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+		TP_STORE(col[0] + i * 4, _mm_unpacklo_epi64(t0, t1));
+		TP_STORE(col[1] + i * 4, _mm_unpackhi_epi64(t0, t1));
+		TP_STORE(col[2] + i * 4, _mm_unpacklo_epi64(t2, t3));
+		TP_STORE(col[3] + i * 4, _mm_unpackhi_epi64(t2, t3));
+	}
+#else
+	(void)col;
+	(void)rec;
+	(void)stride;
+	(void)count;
+#endif
+	return i;
+}
+
+static size_t tp_quad_out(char *const col[4], char *rec, size_t stride,
+                          size_t count)
+{
+	size_t i = 0;
+#if defined __AVX2__
+	for (; i + 8 <= count; i += 8) {
+		char *r = rec + i * stride;
+		__m256i a = _mm256_loadu_si256(
+			(const __m256i *)(const void *)(col[0] + i * 4));
+		__m256i b = _mm256_loadu_si256(
+			(const __m256i *)(const void *)(col[1] + i * 4));
+		__m256i c = _mm256_loadu_si256(
+			(const __m256i *)(const void *)(col[2] + i * 4));
+		__m256i d = _mm256_loadu_si256(
+			(const __m256i *)(const void *)(col[3] + i * 4));
+		__m256i t0 = _mm256_unpacklo_epi32(a, b);
+		__m256i t1 = _mm256_unpacklo_epi32(c, d);
+		__m256i t2 = _mm256_unpackhi_epi32(a, b);
+		__m256i t3 = _mm256_unpackhi_epi32(c, d);
+		__m256i r04 = _mm256_unpacklo_epi64(t0, t1);
+		__m256i r15 = _mm256_unpackhi_epi64(t0, t1);
+		__m256i r26 = _mm256_unpacklo_epi64(t2, t3);
+		__m256i r37 = _mm256_unpackhi_epi64(t2, t3);
+		TP_STORE(r, _mm256_castsi256_si128(r04));
+		TP_STORE(r + stride, _mm256_castsi256_si128(r15));
+		TP_STORE(r + 2 * stride, _mm256_castsi256_si128(r26));
+		TP_STORE(r + 3 * stride, _mm256_castsi256_si128(r37));
+		TP_STORE(r + 4 * stride, _mm256_extracti128_si256(r04, 1));
+		TP_STORE(r + 5 * stride, _mm256_extracti128_si256(r15, 1));
+		TP_STORE(r + 6 * stride, _mm256_extracti128_si256(r26, 1));
+		TP_STORE(r + 7 * stride, _mm256_extracti128_si256(r37, 1));
+	}
+#endif
+#if defined __AVX2__ || defined __SSE2__ || defined _M_X64
+	for (; i + 4 <= count; i += 4) {
+		char *r = rec + i * stride;
+		__m128i a = TP_LOAD(col[0] + i * 4);
+		__m128i b = TP_LOAD(col[1] + i * 4);
+		__m128i c = TP_LOAD(col[2] + i * 4);
+		__m128i d = TP_LOAD(col[3] + i * 4);
+		__m128i t0 = _mm_unpacklo_epi32(a, b);
+		__m128i t1 = _mm_unpacklo_epi32(c, d);
+		__m128i t2 = _mm_unpackhi_epi32(a, b);
+		__m128i t3 = _mm_unpackhi_epi32(c, d);
+		TP_STORE(r, _mm_unpacklo_epi64(t0, t1));
+		TP_STORE(r + stride, _mm_unpackhi_epi64(t0, t1));
+		TP_STORE(r + 2 * stride, _mm_unpacklo_epi64(t2, t3));
+		TP_STORE(r + 3 * stride, _mm_unpackhi_epi64(t2, t3));
+	}
+#else
+	(void)col;
+	(void)rec;
+	(void)stride;
+	(void)count;
+#endif
+	return i;
+}
+
+/* Same as `tp_quad_in()`, for two 8-byte fields. */
+static size_t tp_pair_in(char *const col[2], const char *rec, size_t stride,
+                         size_t count)
+{
+	size_t i = 0;
+#if defined __AVX2__
+	for (; i + 4 <= count; i += 4) {
+		const char *r = rec + i * stride;
+		__m256i r02 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(TP_LOAD(r)),
+			TP_LOAD(r + 2 * stride), 1);
+		__m256i r13 = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(TP_LOAD(r + stride)),
+			TP_LOAD(r + 3 * stride), 1);
+		_mm256_storeu_si256((__m256i *)(void *)(col[0] + i * 8),
+		                    _mm256_unpacklo_epi64(r02, r13));
+		_mm256_storeu_si256((__m256i *)(void *)(col[1] + i * 8),
+		                    _mm256_unpackhi_epi64(r02, r13));
+	}
+#endif
+#if defined __AVX2__ || defined __SSE2__ || defined _M_X64
+	for (; i + 2 <= count; i += 2) {
+		const char *r = rec + i * stride;
+		__m128i r0 = TP_LOAD(r);
+		__m128i r1 = TP_LOAD(r + stride);
+		TP_STORE(col[0] + i * 8, _mm_unpacklo_epi64(r0, r1));
+		TP_STORE(col[1] + i * 8, _mm_unpackhi_epi64(r0, r1));
+	}
+#else
+	(void)col;
+	(void)rec;
+	(void)stride;
+	(void)count;
+#endif
+	return i;
+}
+
+static size_t tp_pair_out(char *const col[2], char *rec, size_t stride,
+                          size_t count)
+{
+	size_t i = 0;
+#if defined __AVX2__
+	for (; i + 4 <= count; i += 4) {
+		char *r = rec + i * stride;
+		__m256i a = _mm256_loadu_si256(
+			(const __m256i *)(const void *)(col[0] + i * 8));
+		__m256i b = _mm256_loadu_si256(
+			(const __m256i *)(const void *)(col[1] + i * 8));
+		__m256i r02 = _mm256_unpacklo_epi64(a, b);
+		__m256i r13 = _mm256_unpackhi_epi64(a, b);
+		TP_STORE(r, _mm256_castsi256_si128(r02));
+		TP_STORE(r + stride, _mm256_castsi256_si128(r13));
+		TP_STORE(r + 2 * stride, _mm256_extracti128_si256(r02, 1));
+		TP_STORE(r + 3 * stride, _mm256_extracti128_si256(r13, 1));
+	}
+#endif
+#if defined __AVX2__ || defined __SSE2__ || defined _M_X64
+	for (; i + 2 <= count; i += 2) {
+		char *r = rec + i * stride;
+		__m128i a = TP_LOAD(col[0] + i * 8);
+		__m128i b = TP_LOAD(col[1] + i * 8);
+		TP_STORE(r, _mm_unpacklo_epi64(a, b));
+		TP_STORE(r + stride, _mm_unpackhi_epi64(a, b));
+	}
+#else
+	(void)col;
+	(void)rec;
+	(void)stride;
+	(void)count;
+#endif
+	return i;
+}
+
+static int tp_check(const struct blayout *lays, size_t stride, size_t n,
+                    size_t nfields, const struct tp_field *fields)
+{
+	size_t i;
+	for (i = 0; i < nfields; ++i) {
+		if (TP_UNLIKELY(fields[i].size != lays[i].size
+		                || lays[i].nmemb < n
+		                || fields[i].size > stride
+		                || fields[i].offset > stride - fields[i].size)) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static void tp_run(char *block, const struct blayout *lays, char *aos,
+                   size_t stride, size_t n, size_t nfields,
+                   const struct tp_field *fields, int out)
+{
+	size_t first, count, i, g, k;
+	for (first = 0; first < n; first += count) {
+		char *region = block;
+		size_t prev_size = 0;
+		count = n - first < TP_TILE ? n - first : TP_TILE;
+		for (i = 0; i < nfields; i += g) {
+			char *col[4];
+			char *rec = aos + first * stride + fields[i].offset;
+			size_t done = 0;
+			g = tp_group(&fields[i], nfields - i);
+			for (k = 0; k < g; ++k) {
+				region = (char *)blnext(region, prev_size,
+				                        lays[i + k].align);
+				prev_size = blsizeof(&lays[i + k]);
+				col[k] = region + first * fields[i + k].size;
+			}
+
+			if (g == 4)
+				done = out ? tp_quad_out(col, rec, stride, count)
+				           : tp_quad_in(col, rec, stride, count);
+			else if (g == 2)
+				done = out ? tp_pair_out(col, rec, stride, count)
+				           : tp_pair_in(col, rec, stride, count);
+			for (k = 0; k < g; ++k)
+				tp_move(col[k] + done * fields[i + k].size,
+				        rec + done * stride
+				            + (fields[i + k].offset - fields[i].offset),
+				        stride, fields[i + k].size, count - done, out);
+		}
+	}
+}
+
+TP_API int tp_aos_to_soa(void *block, const struct blayout *lays,
+                         const void *aos, size_t stride, size_t n,
+                         size_t nfields, const struct tp_field *fields)
+{
+	if (tp_check(lays, stride, n, nfields, fields) != 0)
+		return -1;
+
+	tp_run((char *)block, lays, (char *)aos, stride, n,
+	       nfields, fields, 0);
+	return 0;
+}
+
+TP_API int tp_soa_to_aos(void *aos, size_t stride, size_t n,
+                         const void *block, const struct blayout *lays,
+                         size_t nfields, const struct tp_field *fields)
+{
+	if (tp_check(lays, stride, n, nfields, fields) != 0)
+		return -1;
+
+	tp_run((char *)block, lays, (char *)aos, stride, n,
+	       nfields, fields, 1);
+	return 0;
+}
+
+#undef TP_LOAD
+#undef TP_STORE
+#undef TP_UNLIKELY
+
+#undef TP_IMPL
+#endif  /* TP_IMPL */
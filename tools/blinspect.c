@@ -0,0 +1,387 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Prints where `blnext()` and `blprev()` would place each region of a layout,
+ * along with the padding in front of it and the cache lines and pages it
+ * spans. Then compares against the order of regions that needs the least
+ * padding.
+ *
+ * Regions are given as `NMEMB:SIZE:ALIGN` triples, with `NMEMB` and `SIZE`
+ * nonzero and `ALIGN` a power of two, either as arguments or, if there are
+ * none, on standard input (whitespace-separated, `#` starts a comment).
+ * Example:
+ *
+ *   $ blinspect -a 16 1:1:1 4:8:8 3:2:2
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -I.. blinspect.c -o blinspect
+ */
+
+#define _POSIX_C_SOURCE 200809L
+/* BL_ALIGNMENT, BL_SIZEMAX, struct blayout, blcalc(), blsizeof() */
+#include "blayout.h"
+#include <errno.h>     /* errno */
+#include <inttypes.h>  /* uintmax_t, strtoumax() */
+#include <stddef.h>    /* size_t, ptrdiff_t, NULL */
+#include <stdio.h>     /* printf(), fprintf(), fscanf(), getchar() */
+#include <stdlib.h>    /* realloc(), malloc(), free(), qsort(), EXIT_* */
+#include <unistd.h>    /* getopt(), optarg, optind */
+
+#define MAX_BRUTE 8  /* Try every order for at most this many regions. */
+
+struct opts {
+	size_t align;  /* Of the block. */
+	size_t offs;
+	size_t base;   /* Address the block is assumed to start at. */
+	size_t line;
+	size_t page;
+};
+
+static const char *prog = "blinspect";
+
+static void usage(void)
+{
+	fprintf(stderr,
+	        "usage: %s [-a ALIGN] [-o OFFS] [-b BASE] [-l LINE] [-p PAGE] "
+	        "[NMEMB:SIZE:ALIGN ...]\n"
+	        "  -a  block alignment (default: BL_ALIGNMENT = %zu)\n"
+	        "  -o  offset into the block to start laying out at (default: 0)\n"
+	        "  -b  address of the block, multiple of ALIGN (default: 0)\n"
+	        "  -l  cache line size (default: 64)\n"
+	        "  -p  page size (default: 4096)\n",
+	        prog, (size_t)BL_ALIGNMENT);
+}
+
+static int is_pow2(size_t x)
+{
+	return x != 0 && (x & (x - 1)) == 0;
+}
+
+/* Parses a non-negative number, in any base `strtoumax()` accepts. */
+static int parse_size(const char *s, char **end, size_t *out)
+{
+	uintmax_t v;
+	char *e;
+	if (*s == '-' || *s == '\0')
+		return -1;
+
+	errno = 0;
+	v = strtoumax(s, &e, 0);
+	if (errno != 0 || e == s || v > BL_SIZEMAX)
+		return -1;
+
+	if (end != NULL)
+		*end = e;
+	else if (*e != '\0')
+		return -1;
+
+	*out = (size_t)v;
+	return 0;
+}
+
+static int parse_triple(const char *s, struct blayout *l)
+{
+	char *e;
+	size_t nmemb, size, align;
+	if (parse_size(s, &e, &nmemb) != 0 || *e++ != ':'
+	    || parse_size(e, &e, &size) != 0 || *e++ != ':'
+	    || parse_size(e, &e, &align) != 0 || *e != '\0'
+	    || nmemb == 0 || size == 0 || !is_pow2(align))
+		return -1;
+
+	l->nmemb = nmemb;
+	l->size = size;
+	l->align = align;
+	return 0;
+}
+
+static int push(struct blayout **lays, size_t *n, size_t *cap,
+                const struct blayout *l)
+{
+	if (*n == *cap) {
+		size_t c = *cap ? 2 * *cap : 8;
+		struct blayout *p = realloc(*lays, c * sizeof *p);
+		if (p == NULL)
+			return -1;
+
+		*lays = p;
+		*cap = c;
+	}
+	(*lays)[(*n)++] = *l;
+	return 0;
+}
+
+static int read_stdin(struct blayout **lays, size_t *n, size_t *cap)
+{
+	char word[128];
+	int c;
+	for (;;) {
+		struct blayout l;
+		if (fscanf(stdin, " %127[^ \t\r\n#]", word) == 1) {
+			if (parse_triple(word, &l) != 0) {
+				fprintf(stderr, "%s: invalid region `%s`\n", prog, word);
+				return -1;
+			}
+			if (push(lays, n, cap, &l) != 0)
+				return -1;
+		} else if ((c = getchar()) == '#') {
+			while ((c = getchar()) != '\n' && c != EOF)
+				;
+		} else if (c == EOF) {
+			return 0;
+		}
+	}
+}
+
+/*
+ * Offsets, relative to the block, that `blnext()` gives each region when
+ * the regions are laid out in the order `perm`. Returns the offset of the
+ * end of the last region.
+ */
+static size_t place_next(const struct opts *o, const struct blayout *lays,
+                         const size_t *perm, size_t n, size_t *offs)
+{
+	size_t pos = o->base + o->offs;
+	size_t prev_size = 0;
+	size_t i;
+	for (i = 0; i < n; ++i) {
+		const struct blayout *l = &lays[perm[i]];
+		pos += prev_size;
+		pos += ~(pos - 1) & (l->align - 1);
+		offs[i] = pos - o->base;
+		prev_size = blsizeof(l);
+	}
+	return pos + prev_size - o->base;
+}
+
+/*
+ * Same for `blprev()`, starting from the end of a block of `size` bytes
+ * that follow the `o->offs` reserved ones. Returns the offset of the start of
+ * the first region.
+ */
+static size_t place_prev(const struct opts *o, const struct blayout *lays,
+                         const size_t *perm, size_t n, size_t size,
+                         size_t *offs)
+{
+	size_t pos = o->base + o->offs + size;
+	size_t i = n;
+	while (i-- > 0) {
+		const struct blayout *l = &lays[perm[i]];
+		pos -= blsizeof(l);
+		pos &= ~(l->align - 1);
+		offs[i] = pos - o->base;
+	}
+	return pos - o->base;
+}
+
+static void print_table(const struct opts *o, const struct blayout *lays,
+                        const size_t *perm, size_t n, const size_t *offs,
+                        size_t start)
+{
+	size_t prev_end = start;
+	size_t i;
+	printf("  %4s %10s %8s %6s %10s %10s %8s %8s %10s\n", "#", "nmemb",
+	       "size", "align", "offset", "bytes", "padding", "lines", "pages");
+	for (i = 0; i < n; ++i) {
+		const struct blayout *l = &lays[perm[i]];
+		size_t bytes = blsizeof(l);
+		size_t a = o->base + offs[i];
+		size_t last = bytes ? a + bytes - 1 : a;
+		size_t lines = bytes ? last / o->line - a / o->line + 1 : 0;
+		size_t pages = bytes ? last / o->page - a / o->page + 1 : 0;
+		/* A region that fits in one line, but doesn't, is worth a mark. */
+		int split = bytes <= o->line && lines > 1;
+		printf("  %4zu %10zu %8zu %6zu %10zu %10zu %8zu %7zu%c %10zu\n",
+		       perm[i], (size_t)l->nmemb, (size_t)l->size,
+		       (size_t)l->align, offs[i], bytes, offs[i] - prev_end,
+		       lines, split ? '!' : ' ', pages);
+		prev_end = offs[i] + bytes;
+	}
+}
+
+static size_t payload(const struct blayout *lays, size_t n)
+{
+	size_t sum = 0;
+	size_t i;
+	for (i = 0; i < n; ++i)
+		sum += blsizeof(&lays[i]);
+	return sum;
+}
+
+/* Next permutation in lexicographic order; 0 once wrapped around. */
+static int next_perm(size_t *p, size_t n)
+{
+	size_t i, j, t;
+	if (n < 2)
+		return 0;
+
+	for (i = n - 1; i > 0 && p[i - 1] >= p[i]; --i)
+		;
+	if (i == 0)
+		return 0;
+
+	for (j = n - 1; p[j] <= p[i - 1]; --j)
+		;
+	t = p[i - 1], p[i - 1] = p[j], p[j] = t;
+	for (j = n - 1; i < j; ++i, --j)
+		t = p[i], p[i] = p[j], p[j] = t;
+	return 1;
+}
+
+static const struct blayout *sort_lays;
+
+static int by_align_desc(const void *a, const void *b)
+{
+	size_t x = sort_lays[*(const size_t *)a].align;
+	size_t y = sort_lays[*(const size_t *)b].align;
+	if (x != y)
+		return x < y ? 1 : -1;
+
+	/* Stable, so the order only changes where it has to. */
+	x = *(const size_t *)a;
+	y = *(const size_t *)b;
+	return (x > y) - (x < y);
+}
+
+/*
+ * Finds an order of regions whose `blnext()` placement ends earliest. Every
+ * order is tried for up to `MAX_BRUTE` regions; past that, regions are sorted
+ * by decreasing alignment, which is optimal whenever each region's size is a
+ * multiple of its alignment (always true for arrays of C types).
+ */
+static size_t best_order(const struct opts *o, const struct blayout *lays,
+                         size_t n, size_t *best, size_t *perm, size_t *offs)
+{
+	size_t best_end;
+	size_t i;
+	for (i = 0; i < n; ++i)
+		best[i] = perm[i] = i;
+
+	if (n > MAX_BRUTE) {
+		sort_lays = lays;
+		qsort(best, n, sizeof *best, by_align_desc);
+		return place_next(o, lays, best, n, offs);
+	}
+
+	best_end = place_next(o, lays, perm, n, offs);
+	while (next_perm(perm, n)) {
+		size_t end = place_next(o, lays, perm, n, offs);
+		if (end < best_end) {
+			best_end = end;
+			for (i = 0; i < n; ++i)
+				best[i] = perm[i];
+		}
+	}
+	return best_end;
+}
+
+int main(int argc, char **argv)
+{
+	struct opts o = {BL_ALIGNMENT, 0, 0, 64, 4096};
+	struct blayout *lays = NULL;
+	size_t n = 0, cap = 0;
+	size_t *perm, *best, *offs;
+	size_t size, end, start, pay, best_end;
+	int ret = EXIT_FAILURE;
+	int c;
+	size_t i;
+	if (argc > 0)
+		prog = argv[0];
+
+	while ((c = getopt(argc, argv, "a:o:b:l:p:h")) != -1) {
+		size_t *dst;
+		switch (c) {
+		case 'a': dst = &o.align; break;
+		case 'o': dst = &o.offs;  break;
+		case 'b': dst = &o.base;  break;
+		case 'l': dst = &o.line;  break;
+		case 'p': dst = &o.page;  break;
+		case 'h': usage(); return EXIT_SUCCESS;
+		default:  usage(); return EXIT_FAILURE;
+		}
+		if (parse_size(optarg, NULL, dst) != 0) {
+			fprintf(stderr, "%s: invalid value `%s` for -%c\n", prog,
+			        optarg, c);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!is_pow2(o.align) || !is_pow2(o.line) || !is_pow2(o.page)
+	    || o.base % o.align != 0) {
+		fprintf(stderr, "%s: ALIGN, LINE and PAGE must be powers of 2, and "
+		        "BASE a multiple of ALIGN\n", prog);
+		return EXIT_FAILURE;
+	}
+
+	for (i = (size_t)optind; i < (size_t)argc; ++i) {
+		struct blayout l;
+		if (parse_triple(argv[i], &l) != 0) {
+			fprintf(stderr, "%s: invalid region `%s`\n", prog, argv[i]);
+			goto out;
+		}
+		if (push(&lays, &n, &cap, &l) != 0)
+			goto out_nomem;
+	}
+	if (optind == argc && read_stdin(&lays, &n, &cap) != 0)
+		goto out;
+
+	if (n == 0) {
+		usage();
+		goto out;
+	}
+
+	size = blcalc(o.align, (ptrdiff_t)o.offs, n, lays, 0);
+	if (size == 0 || o.base + size < o.base) {
+		fprintf(stderr, "%s: layout overflows\n", prog);
+		goto out;
+	}
+
+	perm = malloc(3 * n * sizeof *perm);
+	if (perm == NULL)
+		goto out_nomem;
+
+	best = perm + n;
+	offs = best + n;
+	pay = payload(lays, n);
+	for (i = 0; i < n; ++i)
+		perm[i] = i;
+
+	printf("block: align=%zu offs=%zu base=%#zx size=%zu (blcalc()), "
+	       "payload=%zu\n\n", o.align, o.offs, o.base, size, pay);
+
+	end = place_next(&o, lays, perm, n, offs);
+	printf("blnext(), left to right: end=%zu padding=%zu\n", end,
+	       end - o.offs - pay);
+	print_table(&o, lays, perm, n, offs, o.offs);
+
+	start = place_prev(&o, lays, perm, n, size, offs);
+	printf("\nblprev(), right to left from the end: start=%zu "
+	       "padding=%zu\n", start, size + o.offs - start - pay);
+	print_table(&o, lays, perm, n, offs, start);
+
+	best_end = best_order(&o, lays, n, best, perm, offs);
+	printf("\npadding-minimal order (%s):", n > MAX_BRUTE
+	       ? "by decreasing alignment" : "exhaustive");
+	for (i = 0; i < n; ++i)
+		printf(" %zu", best[i]);
+	printf("\n  end=%zu padding=%zu\n", best_end, best_end - o.offs - pay);
+	if (best_end < end) {
+		printf("  saves %zu bytes:\n", end - best_end);
+		place_next(&o, lays, best, n, offs);
+		print_table(&o, lays, best, n, offs, o.offs);
+	} else {
+		printf("  the given order is no worse\n");
+	}
+
+	free(perm);
+	ret = EXIT_SUCCESS;
+	goto out;
+
+out_nomem:
+	fprintf(stderr, "%s: out of memory\n", prog);
+out:
+	free(lays);
+	return ret;
+}
@@ -0,0 +1,588 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Compiles a layout schema into a C11 header of accessors. Regions are laid
+ * out by the same rules as `blcalc()` and `blnext()`, but at generation time:
+ * every region up to the first one with a run-time count gets a `static
+ * const` offset, and its accessor adds a constant to the block pointer. The
+ * regions after that get inline offset functions over a `struct NAME_counts`,
+ * and the layout a `NAME_size()` function that chains `blcalc()` from the
+ * size of the fixed prefix. The header pins the size and alignment of every
+ * type it was generated with, so a target that disagrees fails to compile.
+ *
+ * A schema is read from the file given as argument or from standard input,
+ * and the header is written to standard output. `#` starts a comment.
+ *
+ *   include "vec3.h"          # Emitted as is.
+ *   type    vec3 12 4         # Name, size and alignment of a non-builtin type.
+ *
+ *   layout  packet 16         # Name and block alignment (default 16).
+ *   id      uint64_t 1        # Region name, type, count and, optionally, an
+ *   kind    uint8_t  4        # alignment larger than the type's.
+ *   points  vec3     npoints  # A run-time count.
+ *   crc     uint32_t 1
+ *
+ * gives, among others, `packet_id()`, `packet_kind()` and `packet_points()`
+ * (`static const` offsets 0, 8 and 12), `packet_crc(block, &counts)` and
+ * `packet_size(&counts)`. Every accessor has a `_c` variant taking and
+ * returning `const` pointers. As with `blcalc()`, counts must be at least 1;
+ * `NAME_size()` returns 0 otherwise, or if the size wraps around, and the
+ * offset functions assume it didn't.
+ *
+ * The builtin types are `char`, `float`, `double`, and `[u]intN_t` for N = 8,
+ * 16, 32 and 64, with the sizes and alignments of the machine running the
+ * tool. Region alignments can't exceed the block's, since offsets would then
+ * depend on where the block is.
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 -I.. blschema.c -o blschema
+ */
+
+#define _POSIX_C_SOURCE 200809L
+/* BL_SIZEMAX, struct blbuild, blbuild_init(), blextend(), blfinish() */
+#include "blayout.h"
+#include <ctype.h>     /* isalnum(), isalpha(), toupper() */
+#include <errno.h>     /* errno */
+#include <inttypes.h>  /* uintmax_t, strtoumax() */
+#include <stddef.h>    /* size_t, NULL */
+#include <stdint.h>    /* int*_t, uint*_t */
+/* printf(), fprintf(), snprintf(), fopen(), fgets(), perror() */
+#include <stdio.h>
+#include <stdlib.h>    /* EXIT_* */
+#include <string.h>    /* strcmp(), strcpy(), strtok(), strchr() */
+
+#define MAX_NAME     64
+#define MAX_LINE     512
+#define MAX_TOKENS   8
+#define MAX_TYPES    64
+#define MAX_INCLUDES 16
+#define MAX_REGIONS  256
+#define MAX_LAYOUTS  32
+#define MAX_VARS     16  /* Run-time counts per layout. */
+
+struct type {
+	char name[MAX_NAME];
+	size_t size;
+	size_t align;
+	int used;
+};
+
+struct region {
+	char name[MAX_NAME];
+	size_t type;
+	size_t count;        /* If `var` is empty. */
+	char var[MAX_NAME];
+	size_t align;
+	size_t offset;       /* If constant. */
+};
+
+struct layout {
+	char name[MAX_NAME];
+	size_t align;
+	size_t first;        /* Into `regions`. */
+	size_t n;
+	size_t fixed;        /* Regions before the first run-time count. */
+	size_t fixed_size;
+};
+
+#define BUILTIN(T) {#T, sizeof(T), _Alignof(T), 0}
+
+static struct type types[MAX_TYPES] = {
+	BUILTIN(char),
+	BUILTIN(float),
+	BUILTIN(double),
+	BUILTIN(int8_t),
+	BUILTIN(int16_t),
+	BUILTIN(int32_t),
+	BUILTIN(int64_t),
+	BUILTIN(uint8_t),
+	BUILTIN(uint16_t),
+	BUILTIN(uint32_t),
+	BUILTIN(uint64_t),
+};
+static size_t ntypes = 11;
+
+static struct region regions[MAX_REGIONS];
+static size_t nregions;
+static struct layout layouts[MAX_LAYOUTS];
+static size_t nlayouts;
+static char includes[MAX_INCLUDES][MAX_NAME];
+static size_t nincludes;
+
+static const char *prog = "blschema";
+static const char *path = "<stdin>";
+static unsigned long lineno;
+
+static int fail(const char *msg, const char *what)
+{
+	fprintf(stderr, "%s:%lu: %s `%s`\n", path, lineno, msg, what);
+	return -1;
+}
+
+static int is_pow2(size_t x)
+{
+	return x != 0 && (x & (x - 1)) == 0;
+}
+
+static int is_ident(const char *s)
+{
+	if (!isalpha((unsigned char)*s) && *s != '_')
+		return 0;
+	while (*++s != '\0')
+		if (!isalnum((unsigned char)*s) && *s != '_')
+			return 0;
+	return 1;
+}
+
+/* Parses a number, in any base `strtoumax()` accepts. */
+static int parse_size(const char *s, size_t *out)
+{
+	uintmax_t v;
+	char *e;
+	if (*s == '-' || *s == '\0')
+		return -1;
+
+	errno = 0;
+	v = strtoumax(s, &e, 0);
+	if (errno != 0 || *e != '\0' || v > BL_SIZEMAX)
+		return -1;
+
+	*out = (size_t)v;
+	return 0;
+}
+
+static int copy_name(char *dst, const char *src)
+{
+	if (!is_ident(src))
+		return fail("invalid name", src);
+	if (strlen(src) >= MAX_NAME)
+		return fail("name too long", src);
+
+	strcpy(dst, src);
+	return 0;
+}
+
+static struct type *find_type(const char *name)
+{
+	size_t i;
+	for (i = 0; i < ntypes; ++i)
+		if (strcmp(types[i].name, name) == 0)
+			return &types[i];
+	return NULL;
+}
+
+static int add_type(char **tok, size_t ntok)
+{
+	struct type *t;
+	if (ntok != 4)
+		return fail("expected `type NAME SIZE ALIGN`, got", tok[0]);
+	if (find_type(tok[1]) != NULL)
+		return fail("redefined type", tok[1]);
+	if (ntypes == MAX_TYPES)
+		return fail("too many types at", tok[1]);
+
+	t = &types[ntypes];
+	if (copy_name(t->name, tok[1]) != 0)
+		return -1;
+	if (parse_size(tok[2], &t->size) != 0 || t->size == 0)
+		return fail("invalid size", tok[2]);
+	if (parse_size(tok[3], &t->align) != 0 || !is_pow2(t->align)
+	    || t->size % t->align != 0)
+		return fail("invalid alignment", tok[3]);
+
+	++ntypes;
+	return 0;
+}
+
+static int add_layout(char **tok, size_t ntok)
+{
+	struct layout *l;
+	size_t i;
+	if (ntok != 2 && ntok != 3)
+		return fail("expected `layout NAME [ALIGN]`, got", tok[0]);
+	if (nlayouts == MAX_LAYOUTS)
+		return fail("too many layouts at", tok[1]);
+
+	l = &layouts[nlayouts];
+	if (copy_name(l->name, tok[1]) != 0)
+		return -1;
+	for (i = 0; i < nlayouts; ++i)
+		if (strcmp(layouts[i].name, l->name) == 0)
+			return fail("redefined layout", l->name);
+
+	l->align = 16;
+	if (ntok == 3 && (parse_size(tok[2], &l->align) != 0
+	                  || !is_pow2(l->align)))
+		return fail("invalid alignment", tok[2]);
+
+	l->first = nregions;
+	l->n = 0;
+	++nlayouts;
+	return 0;
+}
+
+static int add_region(char **tok, size_t ntok)
+{
+	struct layout *l;
+	struct region *r;
+	const struct type *t;
+	size_t i;
+	if (nlayouts == 0)
+		return fail("region outside of a layout:", tok[0]);
+	if (ntok != 3 && ntok != 4)
+		return fail("expected `NAME TYPE COUNT [ALIGN]`, got", tok[0]);
+	if (nregions == MAX_REGIONS)
+		return fail("too many regions at", tok[0]);
+
+	l = &layouts[nlayouts - 1];
+	r = &regions[nregions];
+	if (copy_name(r->name, tok[0]) != 0)
+		return -1;
+	/* Would clash with `NAME_size()` and `NAME_fixed_size`. */
+	if (strcmp(r->name, "size") == 0 || strcmp(r->name, "fixed_size") == 0)
+		return fail("reserved region name", r->name);
+	for (i = l->first; i < nregions; ++i)
+		if (strcmp(regions[i].name, r->name) == 0)
+			return fail("redefined region", r->name);
+
+	t = find_type(tok[1]);
+	if (t == NULL)
+		return fail("unknown type", tok[1]);
+
+	r->type = (size_t)(t - types);
+	r->var[0] = '\0';
+	r->count = 0;
+	if (is_ident(tok[2])) {
+		if (copy_name(r->var, tok[2]) != 0)
+			return -1;
+	} else if (parse_size(tok[2], &r->count) != 0 || r->count == 0) {
+		return fail("invalid count", tok[2]);
+	}
+
+	r->align = t->align;
+	if (ntok == 4 && (parse_size(tok[3], &r->align) != 0
+	                  || !is_pow2(r->align) || r->align < t->align))
+		return fail("invalid alignment", tok[3]);
+	if (r->align > l->align)
+		return fail("alignment exceeds the block's for", r->name);
+
+	types[r->type].used = 1;
+	++nregions;
+	++l->n;
+	return 0;
+}
+
+static int add_include(char **tok, size_t ntok)
+{
+	size_t len;
+	if (ntok != 2)
+		return fail("expected `include \"FILE\"`, got", tok[0]);
+
+	len = strlen(tok[1]);
+	if (len < 3 || !((tok[1][0] == '"' && tok[1][len - 1] == '"')
+	                 || (tok[1][0] == '<' && tok[1][len - 1] == '>')))
+		return fail("invalid file name", tok[1]);
+	if (nincludes == MAX_INCLUDES || len >= MAX_NAME)
+		return fail("too many includes at", tok[1]);
+
+	strcpy(includes[nincludes++], tok[1]);
+	return 0;
+}
+
+static int parse(FILE *f)
+{
+	char line[MAX_LINE];
+	while (fgets(line, sizeof line, f) != NULL) {
+		char *tok[MAX_TOKENS];
+		size_t ntok = 0;
+		char *s;
+		int r;
+		++lineno;
+		if (strchr(line, '\n') == NULL && !feof(f))
+			return fail("line too long:", "...");
+
+		s = strchr(line, '#');
+		if (s != NULL)
+			*s = '\0';
+		for (s = strtok(line, " \t\r\n"); s != NULL;
+		     s = strtok(NULL, " \t\r\n")) {
+			if (ntok == MAX_TOKENS)
+				return fail("too many words at", s);
+			tok[ntok++] = s;
+		}
+		if (ntok == 0)
+			continue;
+
+		if (strcmp(tok[0], "include") == 0)
+			r = add_include(tok, ntok);
+		else if (strcmp(tok[0], "type") == 0)
+			r = add_type(tok, ntok);
+		else if (strcmp(tok[0], "layout") == 0)
+			r = add_layout(tok, ntok);
+		else
+			r = add_region(tok, ntok);
+		if (r != 0)
+			return -1;
+	}
+	return ferror(f) ? fail("read error in", path) : 0;
+}
+
+static void print_upper(const char *s)
+{
+	while (*s != '\0')
+		putchar(toupper((unsigned char)*s++));
+}
+
+/*
+ * Declares `NAME_REGION()` and `NAME_REGION_c()`, returning `block + OFFS`,
+ * with a `struct NAME_counts *` parameter if `counts`.
+ */
+static void print_accessors(const struct layout *l, const struct region *r,
+                            int counts, const char *offs)
+{
+	const char *t = types[r->type].name;
+	int c;
+	for (c = 0; c < 2; ++c) {
+		const char *q = c ? "const " : "";
+		int w;
+		printf("static inline %s%s *%s_%s%s(%svoid *block%n", q, t,
+		       l->name, r->name, c ? "_c" : "", q, &w);
+		if (counts)
+			printf(",\n%*sconst struct %s_counts *c",
+			       w - (int)strlen(q) - (int)strlen("void *block"), "",
+			       l->name);
+		printf(")\n"
+		       "{\n"
+		       "\treturn (%s%s *)((%schar *)block + %s);\n"
+		       "}\n\n", q, t, q, offs);
+	}
+}
+
+/* `c->VAR` or `COUNT`. */
+static void print_count(const struct region *r)
+{
+	if (r->var[0] != '\0')
+		printf("c->%s", r->var);
+	else
+		printf("%zu", r->count);
+}
+
+/*
+ * Lays out the fixed prefix and the first region after it, which is all
+ * that has a constant offset.
+ */
+static int lay_out(struct layout *l)
+{
+	struct region *rs = &regions[l->first];
+	const char *vars[MAX_VARS];
+	size_t nvars = 0;
+	struct blbuild b;
+	size_t i, j;
+	if (l->n == 0) {
+		fprintf(stderr, "%s: layout `%s` has no regions\n", path, l->name);
+		return -1;
+	}
+
+	blbuild_init(&b, l->align, 0);
+	l->fixed = l->n;
+	l->fixed_size = 0;
+	for (i = 0; i < l->n; ++i) {
+		struct region *r = &rs[i];
+		if (r->var[0] == '\0') {
+			r->offset = blextend(&b, r->count, types[r->type].size,
+			                     r->align);
+		} else if (l->fixed == l->n) {
+			struct blbuild t = b;
+			l->fixed = i;
+			l->fixed_size = i == 0 ? 0 : blfinish(&b, NULL);
+			r->offset = blextend(&t, 1, types[r->type].size, r->align);
+			if (blfinish(&t, NULL) == 0)
+				break;
+		}
+		if (i < l->fixed && blfinish(&b, NULL) == 0)
+			break;
+
+		for (j = 0; r->var[0] != '\0' && j < nvars; ++j)
+			if (strcmp(vars[j], r->var) == 0)
+				break;
+		if (r->var[0] != '\0' && j == nvars) {
+			if (nvars == MAX_VARS) {
+				fprintf(stderr, "%s: layout `%s` has too many "
+				        "counts\n", path, l->name);
+				return -1;
+			}
+			vars[nvars++] = r->var;
+		}
+	}
+	if (i < l->n) {
+		fprintf(stderr, "%s: layout `%s` overflows\n", path, l->name);
+		return -1;
+	}
+
+	if (l->fixed == l->n)
+		l->fixed_size = blfinish(&b, NULL);
+	return 0;
+}
+
+static void emit_layout(const struct layout *l)
+{
+	const struct region *rs = &regions[l->first];
+	const size_t fixed = l->fixed;
+	const char *vars[MAX_VARS];
+	size_t nvars = 0;
+	size_t i, j;
+	char offs[MAX_NAME * 2 + 32];
+
+	printf("/*\n * `%s`, for blocks aligned to %zu bytes.\n */\n", l->name,
+	       l->align);
+	printf("#define ");
+	print_upper(l->name);
+	printf("_ALIGN %zu\n\n", l->align);
+	for (i = 0; i < fixed; ++i) {
+		printf("static const size_t %s_%s_offset = %zu;\n\n", l->name,
+		       rs[i].name, rs[i].offset);
+		snprintf(offs, sizeof offs, "%zu", rs[i].offset);
+		print_accessors(l, &rs[i], 0, offs);
+	}
+	if (fixed == l->n) {
+		printf("static const size_t %s_size = %zu;\n\n", l->name,
+		       l->fixed_size);
+		return;
+	}
+
+	/* The run-time tail. Its first region still has a constant offset. */
+	printf("static const size_t %s_fixed_size = %zu;\n\n", l->name,
+	       l->fixed_size);
+	printf("struct %s_counts {\n", l->name);
+	for (i = fixed; i < l->n; ++i) {
+		if (rs[i].var[0] == '\0')
+			continue;
+		for (j = 0; j < nvars && strcmp(vars[j], rs[i].var) != 0; ++j)
+			;
+		if (j == nvars) {
+			vars[nvars++] = rs[i].var;
+			printf("\tsize_t %s;\n", rs[i].var);
+		}
+	}
+	printf("};\n\n");
+
+	printf("static const size_t %s_%s_offset = %zu;\n\n", l->name,
+	       rs[fixed].name, rs[fixed].offset);
+	snprintf(offs, sizeof offs, "%zu", rs[fixed].offset);
+	print_accessors(l, &rs[fixed], 0, offs);
+
+	for (i = fixed + 1; i < l->n; ++i) {
+		const struct region *p = &rs[i - 1];
+		const struct region *r = &rs[i];
+		printf("static inline size_t %s_%s_offset(const struct %s_counts "
+		       "*c)\n"
+		       "{\n"
+		       "\tconst size_t end = ", l->name, r->name, l->name);
+		if (i == fixed + 1)
+			printf("%s_%s_offset", l->name, p->name);
+		else
+			printf("%s_%s_offset(c)", l->name, p->name);
+		if (p->var[0] != '\0')
+			printf(" + c->%s * %zu;\n", p->var, types[p->type].size);
+		else
+			printf(" + %zu;\n", p->count * types[p->type].size);
+		if (r->align > 1)
+			printf("\treturn (end + %zu) & ~(size_t)%zu;\n",
+			       r->align - 1, r->align - 1);
+		else
+			printf("\treturn end;\n");
+		printf("}\n\n");
+
+		snprintf(offs, sizeof offs, "%s_%s_offset(c)", l->name, r->name);
+		print_accessors(l, r, 1, offs);
+	}
+
+	/* Chained from the fixed prefix, like `blcalc(..., prev_size)`. */
+	printf("/* 0 if a count is 0 or the size wraps around. */\n"
+	       "static inline size_t %s_size(const struct %s_counts *c)\n"
+	       "{\n"
+	       "\tconst struct blayout lays[%zu] = {\n", l->name, l->name,
+	       l->n - fixed);
+	for (i = fixed; i < l->n; ++i) {
+		printf("\t\t{");
+		print_count(&rs[i]);
+		printf(", %zu, %zu},\n", types[rs[i].type].size, rs[i].align);
+	}
+	printf("\t};\n");
+	if (nvars > 0) {
+		printf("\tif (");
+		for (j = 0; j < nvars; ++j)
+			printf("%sc->%s == 0", j == 0 ? "" : " || ", vars[j]);
+		printf(")\n\t\treturn 0;\n\n");
+	}
+	printf("\treturn blcalc(");
+	print_upper(l->name);
+	printf("_ALIGN, 0, %zu, lays, %s_fixed_size);\n"
+	       "}\n\n", l->n - fixed, l->name);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *f = stdin;
+	size_t i;
+	int r;
+	if (argc > 0)
+		prog = argv[0];
+	if (argc > 2) {
+		fprintf(stderr, "usage: %s [SCHEMA]\n", prog);
+		return EXIT_FAILURE;
+	}
+	if (argc == 2) {
+		path = argv[1];
+		f = fopen(path, "r");
+		if (f == NULL) {
+			perror(path);
+			return EXIT_FAILURE;
+		}
+	}
+
+	r = parse(f);
+	if (f != stdin)
+		fclose(f);
+	if (r != 0)
+		return EXIT_FAILURE;
+	if (nlayouts == 0) {
+		fprintf(stderr, "%s: no layouts\n", path);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < nlayouts; ++i)
+		if (lay_out(&layouts[i]) != 0)
+			return EXIT_FAILURE;
+
+	printf("/* Generated by blschema from `%s`. Do not edit. */\n\n", path);
+	printf("#ifndef ");
+	print_upper(layouts[0].name);
+	printf("_SCHEMA_H\n#define ");
+	print_upper(layouts[0].name);
+	printf("_SCHEMA_H\n\n");
+	printf("#include \"blayout.h\"  /* struct blayout, blcalc() */\n"
+	       "#include <stddef.h>   /* size_t */\n"
+	       "#include <stdint.h>   /* int*_t, uint*_t */\n");
+	for (i = 0; i < nincludes; ++i)
+		printf("#include %s\n", includes[i]);
+	printf("\n");
+
+	/* The offsets below only hold for these. */
+	for (i = 0; i < ntypes; ++i) {
+		if (!types[i].used)
+			continue;
+		printf("_Static_assert(sizeof(%s) == %zu && _Alignof(%s) == %zu,\n"
+		       "               \"`%s` differs from the schema\");\n",
+		       types[i].name, types[i].size, types[i].name,
+		       types[i].align, types[i].name);
+	}
+	printf("\n");
+
+	for (i = 0; i < nlayouts; ++i)
+		emit_layout(&layouts[i]);
+
+	printf("#endif\n");
+	return fflush(stdout) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,191 @@
+/* Copyright 2025, pan (pan_@disroot.org) */
+/* SPDX-License-Identifier: MIT-0 */
+
+/*
+ * Measures how long it takes to compile translation units with many calls to
+ * `blnext()`, `blprev()`, `blmemb()`, `blsizeof()` and `blcalc()`, under each
+ * `BL_DEBUG`/`BL_CONST` setting, with and without `BL_LEAN` (which only makes
+ * a difference under `BL_DEBUG=3`), and with `blayout-tiny.h` as a baseline.
+ * The units are valid C and C++, so `-c c++ -f '-x c++'` works too.
+ *
+ * The generated units are compiled with `CC -c`, `-n` gives the number of
+ * call sites per unit (repeatable), and the best of `-r` runs is reported.
+ * Example:
+ *
+ *   $ compile-bench -c gcc -f '-O2 -std=c11' -n 1000 -n 4000
+ *
+ * Build with something like:
+ *
+ *   cc -std=c11 -O2 compile-bench.c -o compile-bench
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>   /* printf(), fprintf(), fopen(), perror(), remove() */
+#include <stdlib.h>  /* system(), strtoul(), mkdtemp(), EXIT_* */
+#include <time.h>    /* clock_gettime() */
+#include <unistd.h>  /* getopt(), optarg, rmdir() */
+
+#define MAX_SIZES 8
+#define PER_FUNC  64  /* Call sites per generated function. */
+
+struct config {
+	const char *name;
+	const char *defines;
+};
+
+static const struct config configs[] = {
+	{"tiny",                "-DBL_TINY"},
+	{"DEBUG=0",             "-DBL_DEBUG=0"},
+	{"DEBUG=1",             "-DBL_DEBUG=1"},
+	{"DEBUG=2",             "-DBL_DEBUG=2"},
+	{"DEBUG=3",             "-DBL_DEBUG=3"},
+	{"DEBUG=3 LEAN",        "-DBL_DEBUG=3 -DBL_LEAN=1"},
+	{"DEBUG=0 CONST=2",     "-DBL_DEBUG=0 -DBL_CONST=2"},
+	{"DEBUG=3 CONST=2",     "-DBL_DEBUG=3 -DBL_CONST=2"},
+	{"DEBUG=3 CONST=2 LEAN", "-DBL_DEBUG=3 -DBL_CONST=2 -DBL_LEAN=1"},
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Every site does the usual walk, plus one nested call, since every nesting
+ * level multiplies the expansion of the inner argument.
+ */
+static int generate(const char *path, unsigned long sites)
+{
+	FILE *f = fopen(path, "w");
+	unsigned long i;
+	if (f == NULL)
+		return -1;
+
+	fprintf(f,
+	        "#ifdef BL_TINY\n"
+	        "#include \"blayout-tiny.h\"\n"
+	        "#else\n"
+	        "#include \"blayout.h\"\n"
+	        "#endif\n"
+	        "static const struct blayout lays[4] = "
+	        "{{3, 1, 1}, {2, 8, 8}, {5, 4, 4}, {1, 16, 16}};\n");
+	for (i = 0; i < sites; ++i) {
+		if (i % PER_FUNC == 0)
+			fprintf(f, "size_t f%lu(char *p, char *q, char *m)\n"
+			           "{\n"
+			           "\tsize_t s = 0;\n", i / PER_FUNC);
+		fprintf(f,
+		        "\tp = (char *)blnext(p, blsizeof(&lays[%lu]), "
+		        "lays[%lu].align);\n"
+		        "\tq = (char *)blprev(blprev(q, %lu, 8), 4, 4);\n"
+		        "\tm = (char *)blmemb(m, 4, %lu);\n",
+		        i % 4, (i + 1) % 4, i % 32 + 1, i % 7);
+		if (i % 16 == 0)
+			fprintf(f, "\ts += blcalc(16, 0, 4, lays, %lu);\n", i % 8);
+		if (i % PER_FUNC == PER_FUNC - 1 || i == sites - 1)
+			fprintf(f, "\treturn s + (size_t)(p - q) + (size_t)m[0];\n"
+			           "}\n");
+	}
+	return fclose(f);
+}
+
+/* Best of `repeat` runs, in seconds, or a negative value on failure. */
+static double measure(const char *cmd, unsigned long repeat)
+{
+	double best = -1;
+	unsigned long r;
+	for (r = 0; r < repeat; ++r) {
+		double t = now();
+		if (system(cmd) != 0)
+			return -1;
+
+		t = now() - t;
+		if (best < 0 || t < best)
+			best = t;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const char *cc = "cc";
+	const char *cflags = "-O0";
+	const char *inc = "..";
+	unsigned long sizes[MAX_SIZES];
+	unsigned long repeat = 3;
+	size_t nsizes = 0;
+	size_t c, s;
+	char dir[] = "/tmp/blbench.XXXXXX";
+	char src[64], obj[64], cmd[1024];
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:f:I:n:r:")) != -1) {
+		switch (opt) {
+		case 'c':
+			cc = optarg;
+			break;
+		case 'f':
+			cflags = optarg;
+			break;
+		case 'I':
+			inc = optarg;
+			break;
+		case 'n':
+			if (nsizes == MAX_SIZES) {
+				fprintf(stderr, "at most %d `-n`\n", MAX_SIZES);
+				return EXIT_FAILURE;
+			}
+			sizes[nsizes++] = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			repeat = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-c CC] [-f CFLAGS] [-I DIR] "
+			                "[-n SITES]... [-r REPEAT]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (nsizes == 0) {
+		sizes[nsizes++] = 1000;
+		sizes[nsizes++] = 4000;
+	}
+
+	if (mkdtemp(dir) == NULL) {
+		perror("mkdtemp");
+		return EXIT_FAILURE;
+	}
+	snprintf(src, sizeof src, "%s/tu.c", dir);
+	snprintf(obj, sizeof obj, "%s/tu.o", dir);
+
+	printf("%s %s\n%-22s", cc, cflags, "");
+	for (s = 0; s < nsizes; ++s)
+		printf(" %8lu", sizes[s]);
+	printf("  sites\n");
+	for (c = 0; c < sizeof configs / sizeof configs[0]; ++c) {
+		printf("%-22s", configs[c].name);
+		for (s = 0; s < nsizes; ++s) {
+			double t;
+			if (generate(src, sizes[s]) != 0) {
+				perror(src);
+				return EXIT_FAILURE;
+			}
+			snprintf(cmd, sizeof cmd, "%s %s %s -I'%s' -c '%s' -o '%s'",
+			         cc, cflags, configs[c].defines, inc, src, obj);
+			t = measure(cmd, repeat);
+			if (t < 0)
+				printf(" %8s", "error");
+			else
+				printf(" %7.2fs", t);
+			fflush(stdout);
+		}
+		printf("\n");
+	}
+
+	remove(src);
+	remove(obj);
+	rmdir(dir);
+	return EXIT_SUCCESS;
+}